@@ -0,0 +1,314 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// gvm-bench runs roms of the perf suite on gvm-headless several times each,
+// with the core thread pinned to one cpu, and reports the median and median
+// absolute deviation of the time per instruction and MIPS of each. Results
+// are written as a flat JSON object and can be compared against an earlier
+// one to flag regressions.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "cxxopts.hpp"
+#include "stats.h"
+
+namespace {
+
+const char* kSuite[] = {
+  "array", "array2", "array4", "array32", "factorial", "benchmark", "ticks",
+  "oneshot", "oneshot2", "recurring", "recurring2",
+};
+
+// Values of the run stats kept for each benchmark.
+const char* kMetrics[] = {
+  "ns_per_instruction", "mips", "runtime_seconds", "instructions",
+  "wfi_ratio",
+};
+
+// Runs shorter than this are mostly process start up and timer noise.
+const double kMinRuntimeSeconds = 0.05;
+// Runs waiting in wfi longer than this fraction measure sleep time, not the
+// interpreter.
+const double kMaxWfiRatio = 0.5;
+
+struct Summary {
+  double median;
+  double mad;
+};
+
+double Median(std::vector<double> values) {
+  if (values.empty()) return 0;
+  std::sort(values.begin(), values.end());
+  const size_t mid = values.size() / 2;
+  return values.size() % 2 ? values[mid]
+                           : (values[mid - 1] + values[mid]) / 2;
+}
+
+Summary Summarize(const std::vector<double>& values) {
+  const double median = Median(values);
+  std::vector<double> deviations;
+  for (double v : values) deviations.push_back(std::fabs(v - median));
+  return {median, Median(deviations)};
+}
+
+// Runs rom once on gvm, discarding its output, and reads the stats it
+// writes at the end into stats.
+bool RunOnce(const std::string& gvm, const std::string& rom, int cpu,
+             const std::string& stats_path,
+             std::map<std::string, std::string>* stats) {
+  const std::string args[] = {
+    gvm, "--prgrom=" + rom, "--video_mode=null",
+    "--cpu_affinity=" + std::to_string(cpu), "--stats_json=" + stats_path,
+  };
+  std::vector<char*> argv;
+  for (const auto& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+  argv.push_back(nullptr);
+
+  unlink(stats_path.c_str());
+  const pid_t pid = fork();
+  if (pid == -1) {
+    std::cerr << "Unable to start " << gvm << "\n";
+    return false;
+  }
+  if (pid == 0) {
+    const int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    dup2(null, STDERR_FILENO);
+    execv(gvm.c_str(), argv.data());
+    _exit(127);
+  }
+  int status;
+  if (waitpid(pid, &status, 0) == -1 || !WIFEXITED(status) ||
+      WEXITSTATUS(status) != 0) {
+    std::cerr << gvm << " failed running " << rom << "\n";
+    return false;
+  }
+  return gvm::Stats::ReadJson(stats_path, stats);
+}
+
+std::string CpuModel() {
+  std::ifstream in("/proc/cpuinfo");
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.compare(0, 10, "model name") != 0) continue;
+    const size_t colon = line.find(':');
+    if (colon != std::string::npos && colon + 2 <= line.size()) {
+      return line.substr(colon + 2);
+    }
+  }
+  return "unknown";
+}
+
+std::string Quote(const std::string& s) {
+  std::string quoted = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') quoted.push_back('\\');
+    quoted.push_back(c);
+  }
+  return quoted + "\"";
+}
+
+double Number(const std::map<std::string, std::string>& values,
+              const std::string& name) {
+  const auto it = values.find(name);
+  return it == values.end() ? NAN : std::strtod(it->second.c_str(), nullptr);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  cxxopts::Options options(
+      "gvm-bench", "Runs the GVM perf suite and reports time per instruction.");
+  options.add_options()
+    ("benchmarks", "Benchmarks to run, by rom name without extension. "
+                   "Defaults to the whole suite.",
+                   cxxopts::value<std::vector<std::string>>())
+    ("gvm", "gvm-headless binary used to run the roms.",
+            cxxopts::value<std::string>()->default_value("./gvm-headless"))
+    ("rom_dir", "Directory with the roms, assembled from perf/*.asm with "
+                "gsm.",
+                cxxopts::value<std::string>()->default_value("perf"))
+    ("runs", "Measured runs of each benchmark.",
+             cxxopts::value<uint32_t>()->default_value("5"))
+    ("warmup", "Runs of each benchmark before measuring.",
+               cxxopts::value<uint32_t>()->default_value("1"))
+    ("cpu", "Cpu the core thread is pinned to. Negative picks the last one.",
+            cxxopts::value<int>()->default_value("-1"))
+    ("out", "File where the results are written as JSON.",
+            cxxopts::value<std::string>()->default_value(""))
+    ("baseline", "Results of an earlier run to compare against.",
+                 cxxopts::value<std::string>()->default_value(""))
+    ("threshold", "Percent increase of the median time per instruction over "
+                  "the baseline flagged as a regression.",
+                  cxxopts::value<double>()->default_value("5"))
+    ("noise", "The increase must also exceed noise times the larger MAD of "
+              "the two runs to be flagged.",
+              cxxopts::value<double>()->default_value("3"));
+  options.parse_positional({"benchmarks"});
+  auto result = options.parse(argc, argv);
+
+  std::vector<std::string> benchmarks(std::begin(kSuite), std::end(kSuite));
+  if (result.count("benchmarks")) {
+    benchmarks = result["benchmarks"].as<std::vector<std::string>>();
+  }
+  const std::string gvm = result["gvm"].as<std::string>();
+  const std::string rom_dir = result["rom_dir"].as<std::string>();
+  const uint32_t runs = std::max(1u, result["runs"].as<uint32_t>());
+  const uint32_t warmup = result["warmup"].as<uint32_t>();
+  int cpu = result["cpu"].as<int>();
+  if (cpu < 0) cpu = std::max(1u, std::thread::hardware_concurrency()) - 1;
+
+  std::map<std::string, std::string> baseline;
+  const std::string baseline_path = result["baseline"].as<std::string>();
+  if (!baseline_path.empty() &&
+      !gvm::Stats::ReadJson(baseline_path, &baseline)) {
+    return 1;
+  }
+
+  char stats_path[] = "/tmp/gvm-bench-XXXXXX";
+  const int fd = mkstemp(stats_path);
+  if (fd == -1) {
+    std::cerr << "Unable to create a temporary file\n";
+    return 1;
+  }
+  close(fd);
+
+  char host[256] = "unknown";
+  gethostname(host, sizeof(host) - 1);
+  std::map<std::string, std::string> results = {
+    {"host", Quote(host)}, {"cpu_model", Quote(CpuModel())},
+    {"cpu", std::to_string(cpu)}, {"runs", std::to_string(runs)},
+    {"warmup", std::to_string(warmup)},
+  };
+
+  std::cout << std::left << std::setw(12) << "benchmark" << std::right
+            << std::setw(12) << "ns/instr" << std::setw(12) << "mad"
+            << std::setw(12) << "MIPS" << std::setw(12) << "mad"
+            << std::setw(12) << "runtime s" << "\n";
+  bool failed = false;
+  bool regressed = false;
+  for (const auto& name : benchmarks) {
+    const std::string rom = rom_dir + "/" + name + ".rom";
+    if (!std::ifstream(rom)) {
+      std::cerr << "No rom " << rom << ", assemble it with gsm first\n";
+      failed = true;
+      continue;
+    }
+    std::map<std::string, std::vector<double>> samples;
+    bool ok = true;
+    for (uint32_t i = 0; ok && i < warmup + runs; ++i) {
+      std::map<std::string, std::string> stats;
+      ok = RunOnce(gvm, rom, cpu, stats_path, &stats);
+      if (!ok || i < warmup) continue;
+      for (const char* metric : kMetrics) {
+        const std::string stat = metric == std::string("instructions")
+            ? "gvm_instructions_total" : std::string("gvm_") + metric;
+        samples[metric].push_back(Number(stats, stat));
+      }
+    }
+    if (!ok) {
+      failed = true;
+      continue;
+    }
+
+    std::map<std::string, Summary> summary;
+    for (const char* metric : kMetrics) {
+      summary[metric] = Summarize(samples[metric]);
+      const std::string key = name + "." + metric;
+      std::stringstream median, mad;
+      median << std::setprecision(9) << summary[metric].median;
+      mad << std::setprecision(9) << summary[metric].mad;
+      results[key + ".median"] = median.str();
+      results[key + ".mad"] = mad.str();
+    }
+    const Summary& ns = summary["ns_per_instruction"];
+    const Summary& mips = summary["mips"];
+    std::cout << std::fixed << std::setprecision(3) << std::left
+              << std::setw(12) << name << std::right << std::setw(12)
+              << ns.median << std::setw(12) << ns.mad << std::setw(12)
+              << mips.median << std::setw(12) << mips.mad << std::setw(12)
+              << summary["runtime_seconds"].median;
+
+    // Only benchmarks that measure the interpreter are compared.
+    const char* skip = nullptr;
+    if (summary["runtime_seconds"].median < kMinRuntimeSeconds) {
+      skip = "too short to measure";
+    } else if (summary["wfi_ratio"].median > kMaxWfiRatio) {
+      skip = "waits in wfi, measures sleep";
+    }
+    results[name + ".comparable"] = skip == nullptr ? "true" : "false";
+
+    const double base =
+        Number(baseline, name + ".ns_per_instruction.median");
+    const double base_mad = Number(baseline, name + ".ns_per_instruction.mad");
+    if (skip != nullptr) {
+      std::cout << "  skipped: " << skip;
+    } else if (!baseline.empty() && std::isfinite(base) && base > 0) {
+      const double change = (ns.median / base - 1) * 100;
+      std::cout << std::showpos << std::setw(10) << change << "%"
+                << std::noshowpos;
+      const double noise = result["noise"].as<double>() *
+          std::max(ns.mad, std::isfinite(base_mad) ? base_mad : 0.0);
+      if (change > result["threshold"].as<double>()) {
+        if (ns.median - base > noise) {
+          std::cout << " REGRESSION";
+          regressed = true;
+        } else {
+          std::cout << " within noise";
+        }
+      }
+    }
+    std::cout << "\n";
+  }
+  unlink(stats_path);
+
+  if (!baseline.empty() && (baseline["host"] != host ||
+                            baseline["cpu_model"] != CpuModel())) {
+    std::cerr << "Baseline ran on a different host, compare with care\n";
+  }
+
+  const std::string out_path = result["out"].as<std::string>();
+  if (!out_path.empty()) {
+    std::ofstream out(out_path);
+    out << "{";
+    for (auto it = results.begin(); it != results.end(); ++it) {
+      out << (it == results.begin() ? "\n  " : ",\n  ") << Quote(it->first)
+          << ": " << it->second;
+    }
+    out << "\n}\n";
+    if (!out) {
+      std::cerr << "Unable to write results to " << out_path << "\n";
+      return 1;
+    }
+  }
+  return failed || regressed ? 1 : 0;
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "blitter.h"
+
+#include <cassert>
+#include <cstring>
+
+#include "isa.h"
+#include "pixel_kernels.h"
+
+namespace gvm {
+
+constexpr uint32_t Blitter::kCommandWords;
+constexpr uint32_t Blitter::kError;
+constexpr uint32_t Blitter::kBadRing;
+
+Blitter::Blitter(uint32_t* mem, uint32_t mem_size_bytes, uint32_t glyph_rom)
+    : mem_(mem), mem_size_(mem_size_bytes), glyph_rom_(glyph_rom),
+      ring_reg_(0), size_reg_(0), head_reg_(0), tail_reg_(0),
+      error_reg_(0), signal_(nullptr), shutdown_(false) {
+  assert(mem_ != nullptr);
+}
+
+void Blitter::SetRegisters(uint32_t ring_reg, uint32_t size_reg,
+                           uint32_t head_reg, uint32_t tail_reg,
+                           uint32_t error_reg) {
+  ring_reg_ = ring_reg / kWordSize;
+  size_reg_ = size_reg / kWordSize;
+  head_reg_ = head_reg / kWordSize;
+  tail_reg_ = tail_reg / kWordSize;
+  error_reg_ = error_reg / kWordSize;
+}
+
+void Blitter::Start() {
+  assert(signal_ != nullptr);
+  while (!shutdown_) {
+    if (signal_->Wait() == 0) continue;
+    Drain();
+  }
+}
+
+void Blitter::Stop() {
+  shutdown_ = true;
+  signal_->Close();
+}
+
+void Blitter::Drain() {
+  const uint32_t ring = mem_[ring_reg_];
+  const uint32_t size = mem_[size_reg_];
+  // The ring is checked as size rows of one command, so the math is done in
+  // 64 bits and a huge size can't wrap around.
+  const uint32_t command_bytes = kCommandWords * kWordSize;
+  if (size == 0 || ring % kWordSize != 0 ||
+      !InBounds(ring, command_bytes, command_bytes, size)) {
+    SetError(kError | kBadRing);
+    return;
+  }
+
+  uint32_t tail = mem_[tail_reg_] % size;
+  bool ran = false;
+  while (tail != mem_[head_reg_] % size) {
+    if (!Execute(&mem_[ring / kWordSize + tail * kCommandWords])) {
+      SetError(kError | tail);
+    }
+    tail = (tail + 1) % size;
+    mem_[tail_reg_] = tail;
+    ran = true;
+  }
+  if (ran && interrupt_) interrupt_();
+}
+
+bool Blitter::InBounds(uint32_t addr, uint32_t pitch, uint32_t row_bytes,
+                       uint32_t height) const {
+  if (height == 0 || row_bytes == 0) return true;
+  const uint64_t end =
+      static_cast<uint64_t>(addr) + static_cast<uint64_t>(pitch) * (height - 1) +
+      row_bytes;
+  return end <= mem_size_;
+}
+
+void Blitter::SetError(uint32_t error) {
+  uint32_t none = 0;
+  __atomic_compare_exchange_n(&mem_[error_reg_], &none, error, false,
+                              __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+bool Blitter::Execute(const uint32_t* cmd) {
+  const uint32_t op = cmd[0] & 0xFF;
+  const bool bpp8 = cmd[0] & 0x100;
+  const uint32_t dst = cmd[1];
+  const uint32_t dst_pitch = cmd[2];
+  const uint32_t w = cmd[3] & 0xFFFF;
+  const uint32_t h = cmd[3] >> 16;
+  uint8_t* bytes = reinterpret_cast<uint8_t*>(mem_);
+  const uint32_t row_bytes = bpp8 ? w : w * kWordSize;
+
+  switch (op) {
+    case NOP:
+      return true;
+
+    case FILL: {
+      if (!InBounds(dst, dst_pitch, row_bytes, h)) return false;
+      if (!bpp8 && (dst % kWordSize != 0 || dst_pitch % kWordSize != 0)) {
+        return false;
+      }
+      for (uint32_t y = 0; y < h; ++y) {
+        uint8_t* row = &bytes[dst + y * dst_pitch];
+        if (bpp8) {
+          std::memset(row, cmd[4] & 0xFF, w);
+        } else {
+          Fill32(reinterpret_cast<uint32_t*>(row), cmd[4], w);
+        }
+      }
+      return true;
+    }
+
+    case COPY:
+    case KEYED_COPY: {
+      const uint32_t src = cmd[4];
+      const uint32_t src_pitch = cmd[5];
+      if (!InBounds(dst, dst_pitch, row_bytes, h) ||
+          !InBounds(src, src_pitch, row_bytes, h)) {
+        return false;
+      }
+      if (op == KEYED_COPY &&
+          (bpp8 || dst % kWordSize != 0 || dst_pitch % kWordSize != 0 ||
+           src % kWordSize != 0 || src_pitch % kWordSize != 0)) {
+        return false;
+      }
+      // When the destination starts after the source, rows are copied bottom
+      // up and pixels right to left so an overlapping source is not
+      // overwritten before it is read. memmove does the latter for COPY.
+      const bool backwards = dst > src;
+      for (uint32_t i = 0; i < h; ++i) {
+        const uint32_t y = backwards ? h - 1 - i : i;
+        uint8_t* to = &bytes[dst + y * dst_pitch];
+        const uint8_t* from = &bytes[src + y * src_pitch];
+        if (op == COPY) {
+          std::memmove(to, from, row_bytes);
+        } else if (backwards) {
+          KeyedCopy32Backward(reinterpret_cast<const uint32_t*>(from), cmd[6],
+                              reinterpret_cast<uint32_t*>(to), w);
+        } else {
+          KeyedCopy32(reinterpret_cast<const uint32_t*>(from), cmd[6],
+                      reinterpret_cast<uint32_t*>(to), w);
+        }
+      }
+      return true;
+    }
+
+    case GLYPH: {
+      // Glyphs are 8x16 pixels stored in 4 words, 4 rows per word with the
+      // first row in the lowest byte.
+      const uint32_t glyph = glyph_rom_ + (cmd[4] & 0xFFFF) * 4 * kWordSize;
+      if (dst % kWordSize != 0 || dst_pitch % kWordSize != 0 ||
+          !InBounds(dst, dst_pitch, 8 * kWordSize, 16) ||
+          !InBounds(glyph, 0, 4 * kWordSize, 1)) {
+        return false;
+      }
+      const uint32_t* rows = &mem_[glyph / kWordSize];
+      for (uint32_t y = 0; y < 16; ++y) {
+        const uint8_t bits = (rows[y / 4] >> ((y % 4) * 8)) & 0xFF;
+        GlyphRow32(bits, cmd[5], cmd[6], cmd[7] & 0x01,
+                   reinterpret_cast<uint32_t*>(&bytes[dst + y * dst_pitch]));
+      }
+      return true;
+    }
+
+    default:
+      return false;
+  }
+}
+
+}  // namespace gvm
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _GVM_BLITTER_H_
+#define _GVM_BLITTER_H_
+
+#include <cstdint>
+#include <functional>
+
+#include "sync_types.h"
+
+namespace gvm {
+
+// Blitter executes 2D drawing commands on the host. The guest places commands
+// in a ring of kCommandWords word entries in memory, advances the head
+// register and the blitter runs every command up to it, moving the tail
+// register as it goes. Once the ring is drained, the interrupt callback is
+// called.
+//
+// A command that is out of bounds, misaligned or unknown is skipped. The first
+// one sets the error register to kError plus its ring slot, and later ones
+// leave it alone until the guest writes 0 to it. An invalid ring sets it to
+// kError plus kBadRing.
+//
+// Command layout, one word each:
+//   0: opcode in bits 0-7. Bit 8 selects 8bpp pixels for fill and copy.
+//   1: destination address.
+//   2: destination pitch in bytes.
+//   3: width in bits 0-15, height in bits 16-31, in pixels.
+//   4: fill color, source address or glyph codepoint.
+//   5: source pitch in bytes or glyph foreground color.
+//   6: color key or glyph background color.
+//   7: glyph flags. Bit 0 leaves background pixels untouched.
+class Blitter {
+ public:
+  static constexpr uint32_t kCommandWords = 8;
+  static constexpr uint32_t kError = 0x80000000;
+  static constexpr uint32_t kBadRing = 0x7FFFFFFF;
+
+  enum Opcode {
+    NOP = 0,
+    FILL,
+    COPY,
+    KEYED_COPY,
+    GLYPH,
+  };
+
+  Blitter(uint32_t* mem, uint32_t mem_size_bytes, uint32_t glyph_rom);
+
+  void SetRegisters(uint32_t ring_reg, uint32_t size_reg, uint32_t head_reg,
+                    uint32_t tail_reg, uint32_t error_reg);
+  void SetSignal(Doorbell* signal) { signal_ = signal; }
+  void SetInterrupt(std::function<void()> interrupt) { interrupt_ = interrupt; }
+
+  // Processes commands until Stop is called.
+  void Start();
+  void Stop();
+
+  // Runs every queued command on the calling thread.
+  void Drain();
+
+ private:
+  bool Execute(const uint32_t* cmd);
+  bool InBounds(uint32_t addr, uint32_t pitch, uint32_t row_bytes,
+                uint32_t height) const;
+  // Latches error unless an earlier one is still set.
+  void SetError(uint32_t error);
+
+  uint32_t* mem_;
+  const uint32_t mem_size_;
+  const uint32_t glyph_rom_;
+  uint32_t ring_reg_;
+  uint32_t size_reg_;
+  uint32_t head_reg_;
+  uint32_t tail_reg_;
+  uint32_t error_reg_;
+  Doorbell* signal_;
+  std::function<void()> interrupt_;
+  volatile bool shutdown_;
+};
+
+}  // namespace gvm
+
+#endif  // _GVM_BLITTER_H_
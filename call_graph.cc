@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "call_graph.h"
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+namespace gvm {
+
+constexpr uint32_t CallGraph::kPending;
+constexpr char CallGraph::kOutputOption[];
+
+CallGraph::CallGraph() : count_(0), symbols_(nullptr) {
+  stack_.push_back({kPending, 0, 0, 0});
+}
+
+bool CallGraph::Start(const std::string& path, const SymbolMap* symbols) {
+  path_ = path;
+  symbols_ = symbols;
+  return true;
+}
+
+void CallGraph::Stop(const uint32_t* regs) {
+  while (stack_.size() > 1) Pop();
+  const Frame& root = stack_.back();
+  self_[root.fn] += count_ - root.start - root.children;
+  if (Write()) {
+    std::cerr << "Call graph: " << self_.size() << " functions, "
+              << edges_.size() << " call sites written to " << path_ << "\n";
+  }
+}
+
+void CallGraph::Pop() {
+  const Frame frame = stack_.back();
+  stack_.pop_back();
+  const uint64_t inclusive = count_ - frame.start;
+  self_[frame.fn] += inclusive - frame.children;
+  Frame& caller = stack_.back();
+  caller.children += inclusive;
+
+  const uint64_t key = static_cast<uint64_t>(frame.site) << 32 | frame.fn;
+  auto it = edges_.find(key);
+  if (it == edges_.end()) {
+    it = edges_.insert({key, {caller.fn, frame.fn, 0, 0}}).first;
+  }
+  ++it->second.calls;
+  it->second.inclusive += inclusive;
+}
+
+std::string CallGraph::Name(uint32_t fn) const {
+  if (symbols_ != nullptr) return symbols_->Name(fn);
+  std::stringstream ss;
+  ss << "0x" << std::hex << fn;
+  return ss.str();
+}
+
+bool CallGraph::Write() const {
+  std::ofstream out(path_);
+  if (!out) {
+    std::cerr << "Unable to write call graph to " << path_ << "\n";
+    return false;
+  }
+
+  // Group the call sites by caller so each function is written once, in
+  // address order.
+  std::map<uint32_t, std::map<uint64_t, const Edge*>> calls;
+  for (const auto& kv : self_) calls[kv.first];
+  for (const auto& kv : edges_) calls[kv.second.caller][kv.first] = &kv.second;
+
+  out << "# callgrind format\n"
+      << "version: 1\n"
+      << "creator: gvm\n"
+      << "positions: instr\n"
+      << "events: Instructions\n"
+      << "summary: " << count_ << "\n";
+  for (const auto& fn : calls) {
+    out << "\nfn=" << Name(fn.first) << "\n";
+    const auto self = self_.find(fn.first);
+    out << "0x" << std::hex << fn.first << std::dec << " "
+        << (self == self_.end() ? 0 : self->second) << "\n";
+    for (const auto& site : fn.second) {
+      const Edge& edge = *site.second;
+      out << "cfn=" << Name(edge.callee) << "\n"
+          << "calls=" << edge.calls << " 0x" << std::hex << edge.callee
+          << "\n"
+          << "0x" << (site.first >> 32) << std::dec << " " << edge.inclusive
+          << "\n";
+    }
+  }
+  return static_cast<bool>(out);
+}
+
+}  // namespace gvm
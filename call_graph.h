@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _GVM_CALL_GRAPH_H_
+#define _GVM_CALL_GRAPH_H_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "isa.h"
+#include "symbol_map.h"
+
+namespace gvm {
+
+// CallGraph is a Core instrumentation policy that follows calls, interrupts
+// and returns on a shadow stack. It counts the instructions each function
+// runs itself and, per call site, the calls made and the instructions they
+// ran including their callees. Stop writes them in callgrind format.
+//
+// A function is identified by the first instruction that is not a jmp after
+// it was entered, so interrupts and the reset enter the handler instead of
+// its jump table entry.
+class CallGraph {
+ public:
+  static constexpr char kOutputOption[] = "callgraph_out";
+
+  CallGraph();
+
+  void Op(uint32_t pc, uint32_t word, const uint32_t* regs) {
+    ++count_;
+    if (stack_.back().fn == kPending && (word & 0x3F) != ISA::JMP) {
+      stack_.back().fn = pc;
+    }
+  }
+  void Branch(uint32_t opcode, bool taken) {}
+  void Load(uint32_t addr, uint32_t value) {}
+  void Store(uint32_t addr, uint32_t value) {}
+  // site is the call instruction or, for interrupts, the one interrupted.
+  void Call(uint32_t site) {
+    if (stack_.back().fn == kPending) stack_.back().fn = site;
+    stack_.push_back({kPending, site, count_, 0});
+  }
+  void Ret() {
+    // Returns past the first frame have no call to match.
+    if (stack_.size() > 1) Pop();
+  }
+  void Block(uint32_t pc) {}
+
+  // Remembers path and names functions with symbols, if not null.
+  bool Start(const std::string& path, const SymbolMap* symbols);
+  // Ends every open call and writes the callgrind file.
+  void Stop(const uint32_t* regs);
+
+ private:
+  static constexpr uint32_t kPending = 0xFFFFFFFF;
+
+  struct Frame {
+    uint32_t fn;
+    uint32_t site;
+    uint64_t start;     // count_ when the frame was entered.
+    uint64_t children;  // Instructions run by calls made from the frame.
+  };
+  struct Edge {
+    uint32_t caller;
+    uint32_t callee;
+    uint64_t calls;
+    uint64_t inclusive;
+  };
+
+  void Pop();
+  bool Write() const;
+  std::string Name(uint32_t fn) const;
+
+  uint64_t count_;
+  std::vector<Frame> stack_;
+  // Instructions run by each function itself.
+  std::unordered_map<uint32_t, uint64_t> self_;
+  // Keyed by call site in the high word and callee in the low word.
+  std::unordered_map<uint64_t, Edge> edges_;
+  std::string path_;
+  const SymbolMap* symbols_;
+};
+
+}  // namespace gvm
+
+#endif  // _GVM_CALL_GRAPH_H_
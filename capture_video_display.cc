@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "capture_video_display.h"
+
+#include <cassert>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+
+#include "pixel_kernels.h"
+
+namespace gvm {
+
+CaptureVideoDisplay::CaptureVideoDisplay(const std::string& dump_dir,
+                                         uint32_t dump_every)
+    : dump_dir_(dump_dir), dump_every_(dump_every),
+      text_(Rasterizer::kTextWidth * Rasterizer::kTextHeight, 0),
+      fWidth_(0), fHeight_(0), pending_(false), frame_count_(0),
+      frame_hash_(0) {
+  if (!dump_dir_.empty()) {
+    hashes_.open(dump_dir_ + "/hashes.txt", std::ofstream::trunc);
+    if (!hashes_) {
+      std::cerr << "Unable to write to " << dump_dir_ << "\n";
+    }
+  }
+}
+
+CaptureVideoDisplay::~CaptureVideoDisplay() {
+  std::cerr << "Frames captured: " << frame_count_ << "\n";
+  std::cerr << "Last frame hash: " << std::hex << std::setw(16)
+            << std::setfill('0') << frame_hash_ << std::dec << "\n";
+}
+
+void CaptureVideoDisplay::SetFramebufferSize(int fWidth, int fHeight,
+                                             int bpp) {
+  assert(bpp == 32);
+  fWidth_ = fWidth;
+  fHeight_ = fHeight;
+  graphics_.assign(fWidth * fHeight, 0);
+}
+
+void CaptureVideoDisplay::CopyBuffer(uint32_t* mem, uint32_t mode) {
+  if (mode == kGraphicsMode || mode == kIndexedGraphicsMode) {
+    raster_.CopyGraphics(mem, mode, fWidth_, fHeight_,
+                         reinterpret_cast<uint8_t*>(graphics_.data()),
+                         fWidth_ * sizeof(uint32_t));
+  } else if (mode == kTextMode) {
+    raster_.UpdateText(mem);
+  }
+  pending_ = true;
+}
+
+void CaptureVideoDisplay::SetTextState(uint32_t first_row, uint32_t cursor) {
+  raster_.SetTextState(first_row, cursor);
+}
+
+void CaptureVideoDisplay::Render(uint32_t mode) {
+  // Only frames the guest handed over count. Renders without a new frame
+  // would show the same picture again.
+  if (!pending_) return;
+  pending_ = false;
+
+  const uint32_t* pixels = graphics_.data();
+  int width = fWidth_;
+  int height = fHeight_;
+  if (mode == kTextMode) {
+    int first_dirty;
+    int last_dirty;
+    raster_.DrawText(&first_dirty, &last_dirty);
+    raster_.ResolveText(text_.data());
+    pixels = text_.data();
+    width = Rasterizer::kTextWidth;
+    height = Rasterizer::kTextHeight;
+  } else if (mode != kGraphicsMode && mode != kIndexedGraphicsMode) {
+    return;
+  }
+
+  frame_hash_ = HashPixels(pixels, width * height);
+  if (hashes_) {
+    hashes_ << frame_count_ << " " << std::hex << std::setw(16)
+            << std::setfill('0') << frame_hash_ << std::dec << "\n";
+  }
+  if (!dump_dir_.empty() && dump_every_ != 0 &&
+      frame_count_ % dump_every_ == 0) {
+    Dump(pixels, width, height);
+  }
+  ++frame_count_;
+}
+
+void CaptureVideoDisplay::Dump(const uint32_t* pixels, int width,
+                               int height) {
+  char name[32];
+  snprintf(name, sizeof(name), "/frame_%06llu.ppm",
+           static_cast<unsigned long long>(frame_count_));
+  std::ofstream out(dump_dir_ + name, std::ofstream::binary);
+  if (!out) {
+    std::cerr << "Unable to write " << dump_dir_ << name << "\n";
+    return;
+  }
+  out << "P6\n" << width << " " << height << "\n255\n";
+
+  // Pixels are ABGR8888, so red is the lowest byte.
+  std::vector<uint8_t> row(width * 3);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      const uint32_t px = pixels[y * width + x];
+      row[x * 3] = px & 0xFF;
+      row[x * 3 + 1] = (px >> 8) & 0xFF;
+      row[x * 3 + 2] = (px >> 16) & 0xFF;
+    }
+    out.write(reinterpret_cast<const char*>(row.data()), row.size());
+  }
+}
+
+}  // namespace gvm
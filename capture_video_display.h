@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _GVM_CAPTURE_VIDEO_DISPLAY_H_
+#define _GVM_CAPTURE_VIDEO_DISPLAY_H_
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "rasterizer.h"
+#include "video_display.h"
+
+namespace gvm {
+
+// CaptureVideoDisplay draws frames into memory instead of a window and hashes
+// each one, so what the guest drew can be checked without a display.
+class CaptureVideoDisplay : public VideoDisplay {
+ public:
+  // When dump_dir is not empty, the hash of every frame is appended to
+  // dump_dir/hashes.txt and, if dump_every > 0, every dump_every-th frame is
+  // written there as a PPM file.
+  CaptureVideoDisplay(const std::string& dump_dir, uint32_t dump_every);
+  ~CaptureVideoDisplay() override;
+
+  void SetFramebufferSize(int fWidth, int fHeight, int bpp) override;
+  void SetTextRom(uint32_t* mem) override { raster_.SetTextRom(mem); }
+  void SetColorTable(uint32_t* mem) override { raster_.SetColorTable(mem); }
+  void CopyBuffer(uint32_t* mem, uint32_t mode) override;
+  void SetTextState(uint32_t first_row, uint32_t cursor) override;
+  void Render(uint32_t mode) override;
+  bool CheckEvents() override { return false; }
+
+  uint64_t frame_count() const { return frame_count_; }
+  uint64_t frame_hash() const { return frame_hash_; }
+
+ private:
+  void Dump(const uint32_t* pixels, int width, int height);
+
+  const std::string dump_dir_;
+  const uint32_t dump_every_;
+  Rasterizer raster_;
+  std::vector<uint32_t> graphics_;
+  std::vector<uint32_t> text_;
+  std::ofstream hashes_;
+  int fWidth_;
+  int fHeight_;
+  bool pending_;
+  uint64_t frame_count_;
+  uint64_t frame_hash_;
+};
+
+}  // namespace gvm
+
+#endif  // _GVM_CAPTURE_VIDEO_DISPLAY_H_
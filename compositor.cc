@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "compositor.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "isa.h"
+#include "pixel_kernels.h"
+#include "video_display.h"
+
+namespace gvm {
+
+constexpr uint32_t Compositor::kTileLayer;
+constexpr uint32_t Compositor::kSpriteLayer;
+constexpr int Compositor::kTileSize;
+constexpr int Compositor::kSpriteSize;
+constexpr uint32_t Compositor::kMaxTiles;
+constexpr uint32_t Compositor::kMaxSprites;
+constexpr uint32_t Compositor::kSpriteWords;
+
+Compositor::Compositor(uint32_t* mem, uint32_t mem_size_bytes, int width,
+                       int height)
+    : mem_(mem), mem_size_(mem_size_bytes), width_(width), height_(height),
+      cols_(width / kTileSize), rows_(height / kTileSize),
+      color_table_(nullptr), ctrl_reg_(0), map_reg_(0), tiles_reg_(0),
+      sprites_reg_(0), sprite_count_reg_(0),
+      frame_(width * height, 0), dirty_(cols_ * rows_, 1), full_redraw_(true),
+      map_cache_(cols_ * rows_, 0), tile_cache_(kMaxTiles * kTileSize * kTileSize, 0),
+      tile_changed_(kMaxTiles, true), palette_cache_(256, 0) {
+  assert(mem_ != nullptr);
+  assert(width % kTileSize == 0);
+  assert(height % kTileSize == 0);
+}
+
+void Compositor::SetRegisters(uint32_t ctrl_reg, uint32_t map_reg,
+                              uint32_t tiles_reg, uint32_t sprites_reg,
+                              uint32_t sprite_count_reg) {
+  ctrl_reg_ = ctrl_reg / kWordSize;
+  map_reg_ = map_reg / kWordSize;
+  tiles_reg_ = tiles_reg / kWordSize;
+  sprites_reg_ = sprites_reg / kWordSize;
+  sprite_count_reg_ = sprite_count_reg / kWordSize;
+}
+
+bool Compositor::InBounds(uint32_t addr, uint32_t size) const {
+  return addr % kWordSize == 0 &&
+         static_cast<uint64_t>(addr) + size <= mem_size_;
+}
+
+const uint32_t* Compositor::Compose(const uint32_t* fb, uint32_t mode) {
+  assert(color_table_ != nullptr);
+  const uint32_t ctrl = mem_[ctrl_reg_];
+  const uint32_t map_addr = mem_[map_reg_];
+  const uint32_t tiles_addr = mem_[tiles_reg_];
+  const uint32_t map_size = cols_ * rows_ * kWordSize;
+  const uint32_t tiles_size = kMaxTiles * kTileSize * kTileSize;
+  const bool tile_layer = (ctrl & kTileLayer) &&
+      InBounds(map_addr, map_size) && InBounds(tiles_addr, tiles_size);
+
+  if (!std::equal(palette_cache_.begin(), palette_cache_.end(), color_table_)) {
+    std::copy(color_table_, color_table_ + 256, palette_cache_.begin());
+    full_redraw_ = true;
+  }
+
+  // Without the tile layer the framebuffer is the background, and it may
+  // have changed anywhere.
+  if (!tile_layer) {
+    DrawFramebuffer(fb, mode);
+    full_redraw_ = true;
+  } else {
+    const uint32_t* map = &mem_[map_addr / kWordSize];
+    const uint8_t* tiles = reinterpret_cast<const uint8_t*>(&mem_[tiles_addr / kWordSize]);
+    MarkDirtyTiles(map, tiles);
+  }
+
+  // Cells under sprites are drawn again both where the sprites were and where
+  // they are now.
+  for (const auto& rect : sprites_) MarkSpriteCells(rect);
+  sprites_.clear();
+  std::vector<const uint8_t*> pixels;
+  const uint32_t sprites_addr = mem_[sprites_reg_];
+  const uint32_t count = std::min(mem_[sprite_count_reg_], kMaxSprites);
+  if ((ctrl & kSpriteLayer) && InBounds(sprites_addr, count * kSpriteWords * kWordSize)) {
+    const uint32_t* table = &mem_[sprites_addr / kWordSize];
+    for (uint32_t i = 0; i < count; ++i) {
+      const uint32_t* sprite = &table[i * kSpriteWords];
+      if ((sprite[2] & 0x01) == 0 ||
+          !InBounds(sprite[1], kSpriteSize * kSpriteSize)) {
+        continue;
+      }
+      const Rect rect = {static_cast<int16_t>(sprite[0] & 0xFFFF),
+                         static_cast<int16_t>(sprite[0] >> 16)};
+      sprites_.push_back(rect);
+      pixels.push_back(reinterpret_cast<const uint8_t*>(&mem_[sprite[1] / kWordSize]));
+      MarkSpriteCells(rect);
+    }
+  }
+
+  if (tile_layer) {
+    const uint32_t* map = &mem_[map_addr / kWordSize];
+    const uint8_t* tiles = reinterpret_cast<const uint8_t*>(&mem_[tiles_addr / kWordSize]);
+    for (int cy = 0; cy < rows_; ++cy) {
+      for (int cx = 0; cx < cols_; ++cx) {
+        const int cell = cy * cols_ + cx;
+        if (!full_redraw_ && !dirty_[cell]) continue;
+        const uint32_t tile = (map[cell] & 0xFFFF) % kMaxTiles;
+        DrawTile(cx, cy, &tiles[tile * kTileSize * kTileSize]);
+      }
+    }
+  }
+
+  for (size_t i = 0; i < sprites_.size(); ++i) {
+    DrawSprite(sprites_[i], pixels[i]);
+  }
+
+  full_redraw_ = !tile_layer;
+  std::fill(dirty_.begin(), dirty_.end(), 0);
+  return frame_.data();
+}
+
+void Compositor::MarkDirtyTiles(const uint32_t* map, const uint8_t* tiles) {
+  const uint32_t pattern_size = kTileSize * kTileSize;
+  for (uint32_t t = 0; t < kMaxTiles; ++t) {
+    const uint8_t* pattern = &tiles[t * pattern_size];
+    uint8_t* cached = &tile_cache_[t * pattern_size];
+    tile_changed_[t] = std::memcmp(pattern, cached, pattern_size) != 0;
+    if (tile_changed_[t]) std::memcpy(cached, pattern, pattern_size);
+  }
+  for (int cell = 0; cell < cols_ * rows_; ++cell) {
+    const uint32_t entry = map[cell];
+    if (entry != map_cache_[cell] || tile_changed_[(entry & 0xFFFF) % kMaxTiles]) {
+      dirty_[cell] = 1;
+      map_cache_[cell] = entry;
+    }
+  }
+}
+
+void Compositor::MarkSpriteCells(const Rect& rect) {
+  const int x0 = std::max(rect.x, 0) / kTileSize;
+  const int y0 = std::max(rect.y, 0) / kTileSize;
+  const int x1 = std::min(rect.x + kSpriteSize - 1, width_ - 1) / kTileSize;
+  const int y1 = std::min(rect.y + kSpriteSize - 1, height_ - 1) / kTileSize;
+  for (int cy = y0; cy <= y1; ++cy) {
+    for (int cx = x0; cx <= x1; ++cx) {
+      dirty_[cy * cols_ + cx] = 1;
+    }
+  }
+}
+
+void Compositor::DrawFramebuffer(const uint32_t* fb, uint32_t mode) {
+  if (mode == kIndexedGraphicsMode) {
+    ExpandIndexed(reinterpret_cast<const uint8_t*>(fb), color_table_,
+                  frame_.data(), frame_.size());
+  } else {
+    std::memcpy(frame_.data(), fb, frame_.size() * sizeof(uint32_t));
+  }
+}
+
+void Compositor::DrawTile(int cx, int cy, const uint8_t* pattern) {
+  uint32_t* dst = &frame_[cy * kTileSize * width_ + cx * kTileSize];
+  for (int y = 0; y < kTileSize; ++y) {
+    ExpandIndexed(&pattern[y * kTileSize], color_table_, &dst[y * width_],
+                  kTileSize);
+  }
+}
+
+void Compositor::DrawSprite(const Rect& rect, const uint8_t* pixels) {
+  const int x0 = std::max(rect.x, 0);
+  const int x1 = std::min(rect.x + kSpriteSize, width_);
+  if (x0 >= x1) return;
+  for (int y = std::max(rect.y, 0); y < std::min(rect.y + kSpriteSize, height_); ++y) {
+    ExpandIndexedTransparent(
+        &pixels[(y - rect.y) * kSpriteSize + (x0 - rect.x)], color_table_,
+        &frame_[y * width_ + x0], x1 - x0);
+  }
+}
+
+}  // namespace gvm
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _GVM_COMPOSITOR_H_
+#define _GVM_COMPOSITOR_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace gvm {
+
+// Compositor draws a tile map background and hardware sprites into a host
+// side frame, using tables the guest keeps in memory. Layers are enabled
+// through the control register:
+//   bit 0: tile layer. It replaces the framebuffer as the background.
+//   bit 1: sprites, drawn in table order on top of the background.
+//
+// Tiles are 8x8 and sprites 16x16 pixels, with one byte per pixel indexed
+// through the color table. Index 0 is transparent in sprites. Tile patterns
+// are kept back to back at the tile data address, and the tile map has one
+// word per screen cell, holding a pattern number in bits 0-15. Each sprite
+// table entry has 4 words:
+//   0: x in bits 0-15 and y in bits 16-31, both signed.
+//   1: address of the sprite pixels.
+//   2: bit 0 makes the sprite visible.
+//   3: reserved.
+//
+// Only screen cells whose tile, tile pattern or overlapping sprites changed
+// since the last frame are drawn again.
+class Compositor {
+ public:
+  static constexpr uint32_t kTileLayer = 0x01;
+  static constexpr uint32_t kSpriteLayer = 0x02;
+  static constexpr int kTileSize = 8;
+  static constexpr int kSpriteSize = 16;
+  static constexpr uint32_t kMaxTiles = 1024;
+  static constexpr uint32_t kMaxSprites = 64;
+  static constexpr uint32_t kSpriteWords = 4;
+
+  Compositor(uint32_t* mem, uint32_t mem_size_bytes, int width, int height);
+
+  void SetRegisters(uint32_t ctrl_reg, uint32_t map_reg, uint32_t tiles_reg,
+                    uint32_t sprites_reg, uint32_t sprite_count_reg);
+  void SetColorTable(const uint32_t* color_table) {
+    color_table_ = color_table;
+  }
+
+  bool Enabled() const {
+    return ctrl_reg_ != 0 && (mem_[ctrl_reg_] & (kTileLayer | kSpriteLayer)) != 0;
+  }
+
+  // Composes the enabled layers over the framebuffer fb, which is in the
+  // given graphics mode, and returns the 32bpp frame to show.
+  const uint32_t* Compose(const uint32_t* fb, uint32_t mode);
+
+ private:
+  struct Rect {
+    int x;
+    int y;
+  };
+
+  bool InBounds(uint32_t addr, uint32_t size) const;
+  void MarkDirtyTiles(const uint32_t* map, const uint8_t* tiles);
+  void MarkSpriteCells(const Rect& rect);
+  void DrawFramebuffer(const uint32_t* fb, uint32_t mode);
+  void DrawTile(int cx, int cy, const uint8_t* pattern);
+  void DrawSprite(const Rect& rect, const uint8_t* pixels);
+
+  uint32_t* mem_;
+  const uint32_t mem_size_;
+  const int width_;
+  const int height_;
+  const int cols_;
+  const int rows_;
+  const uint32_t* color_table_;
+  uint32_t ctrl_reg_;
+  uint32_t map_reg_;
+  uint32_t tiles_reg_;
+  uint32_t sprites_reg_;
+  uint32_t sprite_count_reg_;
+
+  std::vector<uint32_t> frame_;
+  std::vector<uint8_t> dirty_;
+  bool full_redraw_;
+  std::vector<uint32_t> map_cache_;
+  std::vector<uint8_t> tile_cache_;
+  std::vector<bool> tile_changed_;
+  std::vector<uint32_t> palette_cache_;
+  std::vector<Rect> sprites_;
+};
+
+}  // namespace gvm
+
+#endif  // _GVM_COMPOSITOR_H_
@@ -18,10 +18,15 @@
 
 #include "computer.h"
 
+#include <algorithm>
 #include <chrono>
+#include <fstream>
 #include <iostream>
 #include <thread>
 
+#include <pthread.h>
+#include <sched.h>
+
 namespace {
 
 const uint32_t kKernelMemSize = 1024 * 1024;
@@ -45,64 +50,129 @@ const uint32_t kRecurringReg = kOneShotReg + 4;
 const uint32_t kOneShot2Reg = kRecurringReg + 4;
 const uint32_t kRecurring2Reg = kOneShot2Reg + 4;
 //const uint32_t kDisksReg = kRecurring2Reg + 4;
+const uint32_t kDisplayPageReg = kRecurring2Reg + 8;
+const uint32_t kVideoStatusReg = kDisplayPageReg + 4;
+const uint32_t kBlitRingReg = kVideoStatusReg + 4;
+const uint32_t kBlitSizeReg = kBlitRingReg + 4;
+const uint32_t kBlitHeadReg = kBlitSizeReg + 4;
+const uint32_t kBlitTailReg = kBlitHeadReg + 4;
+const uint32_t kTextFirstRowReg = kBlitTailReg + 4;
+const uint32_t kTextCursorReg = kTextFirstRowReg + 4;
+const uint32_t kLayerCtrlReg = kTextCursorReg + 4;
+const uint32_t kTileMapReg = kLayerCtrlReg + 4;
+const uint32_t kTileDataReg = kTileMapReg + 4;
+const uint32_t kSpriteTableReg = kTileDataReg + 4;
+const uint32_t kSpriteCountReg = kSpriteTableReg + 4;
+const uint32_t kInputHeadReg = kSpriteCountReg + 4;
+const uint32_t kInputTailReg = kInputHeadReg + 4;
+const uint32_t kPerfCtrlReg = kInputTailReg + 4;
+// Four 64 bit counters, two words each.
+const uint32_t kPerfCountersReg = kPerfCtrlReg + 4;
+const uint32_t kBlitErrorReg = kPerfCountersReg + 32;
+// The input fifo takes the upper half of the IO window.
+const uint32_t kInputFifoStart = kIOStart + kIOMemSize / 2;
+const uint32_t kInputFifoSize = 64;
 const int kFrameBufferW = 640;
 const int kFrameBufferH = 360;
 
+struct Percentile {
+  double p;
+  const char* name;
+};
+const Percentile kPercentiles[] = {{50, "p50"}, {99, "p99"}, {99.9, "p999"}};
+
+int64_t SteadyNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 }  // namespace
 
 namespace gvm {
 
-Computer::Computer(CPU* cpu, Core<MemoryBus>* core, VideoController* video_controller,
-                   DiskController* disk_controller)
+Computer::Computer(ComputerCore* core, VideoController* video_controller,
+                   InputController* input_controller, DiskController* disk_controller)
     : mem_size_bytes_(kMemLimit),
       mem_(new uint32_t[mem_size_bytes_/kWordSize]),
-      cpu_(cpu), core_(core), video_controller_(video_controller), disk_controller_(disk_controller) {
+      core_(core), video_controller_(video_controller), disk_controller_(disk_controller),
+      cpu_affinity_(-1), run_start_(0), run_end_(0), run_start_cycles_(0),
+      run_end_cycles_(0) {
   assert(mem_ != nullptr);
-  assert(cpu_ != nullptr);
   assert(core_ != nullptr);
   assert(video_controller_ != nullptr);
   memset(mem_.get(), 0x0, mem_size_bytes_);
-  video_controller_->SetInputController(new InputController(
-      [this](uint32_t value) {
-    mem_.get()[kInputReg/kWordSize] = value;
-    cpu_->Input();
-    std::this_thread::yield();
-  }));
+  assert(input_controller != nullptr);
+  input_fifo_.reset(new InputFifo(mem_.get()));
+  input_fifo_->SetRegisters(
+      kInputFifoStart, kInputFifoSize, kInputHeadReg, kInputTailReg);
+  input_fifo_->SetInterrupt([this]() {
+    return core_->Input();
+  });
+  input_controller->SetCallback([this](uint32_t type, uint32_t value) {
+    // The input register still holds the latest key or quit value for guests
+    // that don't read the fifo.
+    if (type >= kInputKeyDown && type <= kInputQuit) {
+      mem_.get()[kInputReg/kWordSize] = value;
+    }
+    input_fifo_->Push(type, value);
+  });
+  input_controller->SetInstructionCounter([this]() {
+    return core_->InstructionCount();
+  });
+  video_controller_->SetInputController(input_controller);
   video_controller_->SetSignal(&video_signal_);
+  video_controller_->SetInterrupt([this](uint32_t status) {
+    __atomic_fetch_or(&mem_.get()[kVideoStatusReg / kWordSize], status,
+                      __ATOMIC_SEQ_CST);
+    core_->Video();
+  });
   video_controller_->SetTextRom(&mem_.get()[kUnicodeRomStart/kWordSize]);
   video_controller_->SetColorTable(&mem_.get()[kColorTableStart/kWordSize]);
 
-  cpu_->ConnectMemory(mem_.get(), mem_size_bytes_, kVramStart);
-  cpu_->SetVideoSignal(kVramReg, &video_signal_);
+  core_->ConnectMemory(MemoryBus(mem_.get(), mem_size_bytes_), kVramStart);
+  core_->SetVideoSignal(kVramReg, &video_signal_);
 
   timer_service_.reset(new TimerService(&timer_chan_));
   timer_service_->SetOneShot([this](uint32_t elapsed) {
     mem_.get()[kOneShotReg / kWordSize] = elapsed;
-    cpu_->Timer();
+    core_->Timer();
     std::this_thread::yield();
   });
   timer_service_->SetRecurring([this](uint32_t elapsed) {
     mem_.get()[kRecurringReg / kWordSize] = elapsed;
-    cpu_->RecurringTimer();
+    core_->RecurringTimer();
     std::this_thread::yield();
   });
 
   timer2_service_.reset(new TimerService(&timer2_chan_));
   timer2_service_->SetOneShot([this](uint32_t elapsed) {
     mem_.get()[kOneShot2Reg / kWordSize] = elapsed;
-    cpu_->Timer2();
+    core_->Timer2();
     std::this_thread::yield();
   });
   timer2_service_->SetRecurring([this](uint32_t elapsed) {
     mem_.get()[kRecurring2Reg / kWordSize] = elapsed;
-    cpu_->RecurringTimer2();
+    core_->RecurringTimer2();
     std::this_thread::yield();
   });
 
-  cpu_->SetTimerSignal(kTimerReg, kOneShotReg, kRecurringReg, timer_service_.get());
-  cpu_->SetTimer2Signal(kOneShot2Reg, kRecurring2Reg, timer2_service_.get());
+  core_->SetTimerSignal(kTimerReg, kOneShotReg, kRecurringReg, timer_service_.get());
+  core_->SetTimer2Signal(kOneShot2Reg, kRecurring2Reg, timer2_service_.get());
+  core_->SetPerfCounters(kPerfCtrlReg, kPerfCountersReg);
+
+  blitter_.reset(new Blitter(mem_.get(), mem_size_bytes_, kUnicodeRomStart));
+  blitter_->SetRegisters(kBlitRingReg, kBlitSizeReg, kBlitHeadReg, kBlitTailReg,
+                         kBlitErrorReg);
+  blitter_->SetSignal(&blit_signal_);
+  blitter_->SetInterrupt([this]() {
+    __atomic_fetch_or(&mem_.get()[kVideoStatusReg / kWordSize], kVideoBlitDone,
+                      __ATOMIC_SEQ_CST);
+    core_->Video();
+  });
+  core_->SetBlitterSignal(kBlitHeadReg, &blit_signal_);
 
   RegisterVideoDMA();
+  RegisterStats();
 }
 
 
@@ -119,41 +189,141 @@ void Computer::LoadRom(const Rom* rom) {
   }
 }
 
+void Computer::SetSymbols(SymbolMap* symbols) {
+  symbols_.reset(symbols);
+  core_->SetSymbols(symbols_.get());
+  if (profiler_ != nullptr) profiler_->SetSymbols(symbols_.get());
+}
+
+void Computer::SetProfiler(Profiler* profiler) {
+  profiler_.reset(profiler);
+  profiler_->SetSymbols(symbols_.get());
+  profiler_->SetRequest([this]() {
+    core_->Sample();
+  });
+  core_->SetProfiler(profiler_.get());
+}
+
+void Computer::SetEventLog(EventLog* events) {
+  events_.reset(events);
+  auto* blitter = blitter_.get();
+  core_->SetEventLog(events_.get(), kIOStart, [blitter]() {
+    blitter->Drain();
+  });
+}
+
+void Computer::SetInstrumentationPath(const std::string& path) {
+  instrumentation_path_ = path;
+}
+
+bool Computer::SetStatsOutput(const std::string& json_path,
+                              const std::string& prometheus,
+                              std::chrono::milliseconds period) {
+  stats_json_ = json_path;
+  if (prometheus.empty()) return true;
+  stats_exporter_.reset(new StatsExporter(&stats_, prometheus, period));
+  return stats_exporter_->Init();
+}
+
 void Computer::Run() {
   std::chrono::nanoseconds runtime;
   uint64_t op_count;
 
+  // Replays get every device value from the event log, so the device threads
+  // stay off.
+  const bool devices = events_ == nullptr || !events_->replaying();
   auto* timer = timer_service_.get();
-  std::thread timer_thread([timer]() {
-    timer->Start();
-  });
-
   auto* timer2 = timer2_service_.get();
-  std::thread timer2_thread([timer2]() {
-    timer2->Start();
-  });
+  auto* blitter = blitter_.get();
+  auto* input_fifo = input_fifo_.get();
+  std::thread timer_thread;
+  std::thread timer2_thread;
+  std::thread blitter_thread;
+  std::thread input_fifo_thread;
+  if (devices) {
+    timer_thread = std::thread([timer]() {
+      timer->Start();
+    });
+    timer2_thread = std::thread([timer2]() {
+      timer2->Start();
+    });
+    blitter_thread = std::thread([blitter]() {
+      blitter->Start();
+    });
+    input_fifo_thread = std::thread([input_fifo]() {
+      input_fifo->Start();
+    });
+  }
+
+  auto* profiler = profiler_.get();
+  std::thread profiler_thread;
+  if (profiler != nullptr) {
+    profiler_thread = std::thread([profiler]() {
+      profiler->Start();
+    });
+  }
+
+  auto* stats_exporter = stats_exporter_.get();
+  std::thread stats_thread;
+  if (stats_exporter != nullptr) {
+    stats_thread = std::thread([stats_exporter]() {
+      stats_exporter->Start();
+    });
+  }
 
+  const bool instrumented = !instrumentation_path_.empty() &&
+      core_->StartInstrumentation(instrumentation_path_);
 
-  uint32_t elapsed;
-  std::thread cpu_thread([this, timer, timer2, &elapsed, &runtime, &op_count]() {
-    timer->Reset();
-    timer2->Reset();
+  uint32_t elapsed = 0;
+  std::thread cpu_thread([this, devices, timer, timer2, blitter, input_fifo,
+                          profiler, &elapsed, &runtime, &op_count]() {
+    if (cpu_affinity_ >= 0) {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      CPU_SET(cpu_affinity_, &cpus);
+      if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+        std::cerr << "Unable to pin the cpu thread to cpu " << cpu_affinity_
+                  << "\n";
+      }
+    }
+    if (devices) {
+      timer->Reset();
+      timer2->Reset();
+    }
+    __atomic_store_n(&run_start_cycles_, HostCycles(), __ATOMIC_RELAXED);
+    __atomic_store_n(&run_start_, SteadyNanos(), __ATOMIC_RELAXED);
     const auto start = std::chrono::high_resolution_clock::now();
-    op_count = cpu_->PowerOn();
+    op_count = core_->PowerOn();
     runtime = std::chrono::high_resolution_clock::now() - start;
-    elapsed = timer->Elapsed();
-    timer->Stop();
-    timer2->Stop();
+    __atomic_store_n(&run_end_cycles_, HostCycles(), __ATOMIC_RELAXED);
+    __atomic_store_n(&run_end_, SteadyNanos(), __ATOMIC_RELAXED);
+    if (devices) {
+      elapsed = timer->Elapsed();
+      timer->Stop();
+      timer2->Stop();
+      blitter->Stop();
+      input_fifo->Stop();
+    }
+    if (profiler != nullptr) profiler->Stop();
     video_controller_->Shutdown();
   });
 
   // This has to run on the main thread or it won't render using OpenGL ES.
   video_controller_->Run();
-  timer_thread.join();
-  timer2_thread.join();
+  if (devices) {
+    timer_thread.join();
+    timer2_thread.join();
+    blitter_thread.join();
+    input_fifo_thread.join();
+  }
+  if (profiler_thread.joinable()) profiler_thread.join();
   cpu_thread.join();
+  if (stats_exporter != nullptr) {
+    stats_exporter->Stop();
+    stats_thread.join();
+  }
 
-  std::cerr << cpu_->PrintRegisters(/*hex=*/true);
+  std::cerr << core_->PrintRegisters(/*hex=*/true);
   const auto time = runtime.count();
   const auto per_inst = time / static_cast<double>(op_count);
   auto average_clock = 1000000000 / per_inst / 1000000;
@@ -167,6 +337,123 @@ void Computer::Run() {
   std::cerr << "Average per instruction: " << per_inst << "ns\n";
   std::cerr << "Average clock: " << average_clock << hz << "\n";
   std::cerr << "Timer elapsed: " << (elapsed /10.0) << "ms\n";
+  video_controller_->PrintStats(std::cerr);
+  core_->interrupt_stats().PrintStats(std::cerr);
+  if (instrumented) core_->StopInstrumentation();
+  if (events_ != nullptr) {
+    std::cerr << (events_->replaying() ? "Events replayed: "
+                                       : "Events recorded: ")
+              << events_->events() << "\n";
+    if (events_->replaying() && !events_->done() && !events_->diverged()) {
+      std::cerr << "Replay stopped before the end of the event log\n";
+    }
+    std::cerr << "State digest: 0x" << std::hex << core_->Digest(kIOStart)
+              << std::dec << "\n";
+  }
+  if (!stats_json_.empty()) {
+    std::ofstream out(stats_json_);
+    stats_.WriteJson(out);
+    if (!out) std::cerr << "Unable to write stats to " << stats_json_ << "\n";
+  }
+  if (profiler != nullptr && profiler->Write()) {
+    std::cerr << "Profile samples: " << profiler->samples() << " ("
+              << profiler->dropped() << " dropped)\n";
+  }
+}
+
+void Computer::RegisterStats() {
+  stats_.AddCounter("gvm_instructions_total", "Instructions run.", [this]() {
+    return core_->InstructionCount();
+  });
+  stats_.AddGauge("gvm_runtime_seconds", "Time the core has been running.",
+                  [this]() { return RunSeconds(); });
+  stats_.AddGauge("gvm_mips", "Average millions of instructions per second.",
+                  [this]() {
+    return core_->InstructionCount() / RunSeconds() / 1e6;
+  });
+  stats_.AddGauge("gvm_ns_per_instruction",
+                  "Average nanoseconds per instruction.", [this]() {
+    return RunSeconds() * 1e9 / core_->InstructionCount();
+  });
+
+  stats_.AddGauge("gvm_wfi_ratio",
+                  "Fraction of the run the core spent waiting in wfi.",
+                  [this]() {
+    const uint64_t start =
+        __atomic_load_n(&run_start_cycles_, __ATOMIC_RELAXED);
+    if (start == 0) return 0.0;
+    uint64_t end = __atomic_load_n(&run_end_cycles_, __ATOMIC_RELAXED);
+    if (end == 0) end = HostCycles();
+    return end > start
+        ? core_->WaitCycles() / static_cast<double>(end - start) : 0.0;
+  });
+
+  // Timers, input and video reach the guest as interrupts.
+  const InterruptStats& interrupts = core_->interrupt_stats();
+  for (uint32_t source = 1; source < InterruptStats::kSources; ++source) {
+    std::string name = InterruptStats::SourceName(source);
+    std::replace(name.begin(), name.end(), ' ', '_');
+    const std::string prefix = "gvm_interrupt_" + name;
+    stats_.AddCounter(prefix + "_total", "Handlers dispatched.",
+                      [&interrupts, source]() {
+      return interrupts.taken(source);
+    });
+    for (const Percentile& percentile : kPercentiles) {
+      const double p = percentile.p;
+      const std::string pct = percentile.name;
+      stats_.AddGauge(prefix + "_latency_" + pct + "_seconds",
+                      "Time from raise to handler dispatch.",
+                      [&interrupts, source, p]() {
+        return interrupts.latency(source).Percentile(p) / 1e9;
+      });
+      stats_.AddGauge(prefix + "_handler_" + pct + "_seconds",
+                      "Time from handler dispatch to its return.",
+                      [&interrupts, source, p]() {
+        return interrupts.duration(source).Percentile(p) / 1e9;
+      });
+    }
+  }
+
+  VideoController* video = video_controller_.get();
+  stats_.AddCounter("gvm_frames_requested_total",
+                    "Video doorbells rung by the guest.", [video]() {
+    return video->requested();
+  });
+  stats_.AddCounter("gvm_frames_presented_total", "Frames presented.",
+                    [video]() { return video->presented(); });
+  stats_.AddCounter("gvm_frames_coalesced_total",
+                    "Doorbells merged into a later frame.", [video]() {
+    return video->coalesced();
+  });
+  stats_.AddCounter("gvm_frames_dropped_total",
+                    "Frames missed at the target frame rate.", [video]() {
+    return video->dropped();
+  });
+  for (const Percentile& percentile : kPercentiles) {
+    const double p = percentile.p;
+    const std::string pct = percentile.name;
+    stats_.AddGauge("gvm_frame_time_" + pct + "_seconds",
+                    "Time spent presenting a frame.", [video, p]() {
+      return video->frame_time().Percentile(p) / 1e9;
+    });
+  }
+
+  InputFifo* input = input_fifo_.get();
+  stats_.AddCounter("gvm_input_events_total", "Input events received.",
+                    [input]() { return input->pushed(); });
+
+  DiskController* disks = disk_controller_.get();
+  stats_.AddGauge("gvm_disks", "Disks attached.", [disks]() {
+    return disks == nullptr ? 0 : disks->disk_count();
+  });
+}
+
+double Computer::RunSeconds() const {
+  const int64_t start = __atomic_load_n(&run_start_, __ATOMIC_RELAXED);
+  if (start == 0) return 0;
+  int64_t end = __atomic_load_n(&run_end_, __ATOMIC_RELAXED);
+  if (end == 0) end = SteadyNanos();
+  return (end - start) / 1e9;
 }
 
 void Computer::RegisterVideoDMA() {
@@ -174,6 +461,15 @@ void Computer::RegisterVideoDMA() {
   video_controller_->RegisterDMA(
       kVramReg, kVramStart/kWordSize, kFrameBufferW, kFrameBufferH,
       32, mem_.get());
+  video_controller_->SetDisplayPage(kDisplayPageReg, kVramSize);
+  video_controller_->SetTextRegisters(kTextFirstRowReg, kTextCursorReg);
+
+  auto* compositor = new Compositor(
+      mem_.get(), mem_size_bytes_, kFrameBufferW, kFrameBufferH);
+  compositor->SetRegisters(kLayerCtrlReg, kTileMapReg, kTileDataReg,
+                           kSpriteTableReg, kSpriteCountReg);
+  compositor->SetColorTable(&mem_.get()[kColorTableStart/kWordSize]);
+  video_controller_->SetCompositor(compositor);
 }
 
 }  // namespace gvm
@@ -20,48 +20,101 @@
 #define _GVM_COMPUTER_H_
 
 #include <cassert>
+#include <chrono>
 #include <memory>
+#include <string>
 #include <utility>
 
+#include "blitter.h"
 #include "core.h"
-#include "cpu.h"
 #include "disk_controller.h"
+#include "event_log.h"
 #include "input_controller.h"
+#include "input_fifo.h"
+#include "instrumentation.h"
 #include "memory_bus.h"
+#include "profiler.h"
 #include "rom.h"
+#include "stats.h"
+#include "symbol_map.h"
 #include "sync_types.h"
 #include "timer.h"
 #include "video_controller.h"
 
 namespace gvm {
 
+typedef Core<MemoryBus, CoreInstrumentation> ComputerCore;
+
 class Computer {
  public:
-  // Owns cpu and video_display.
-  Computer(CPU* cpu, Core<MemoryBus>* core, VideoController* video_controller,
-           DiskController* disk_controller);
+  // Owns core and video_controller. Programs run on core.
+  Computer(ComputerCore* core, VideoController* video_controller,
+           InputController* input_controller, DiskController* disk_controller);
 
   // Takes ownership of rom.
   void LoadRom(const Rom* rom);
 
+  // Takes ownership of symbols, used to name guest addresses in reports.
+  void SetSymbols(SymbolMap* symbols);
+
+  // Takes ownership of profiler, which samples the cpu while running.
+  void SetProfiler(Profiler* profiler);
+
+  // Takes ownership of events, which records the run or replays a recorded
+  // one. Replays don't start the timer, blitter and input threads.
+  void SetEventLog(EventLog* events);
+
+  // Where the core's instrumentation, opcode stats or a trace, is written,
+  // if not empty.
+  void SetInstrumentationPath(const std::string& path);
+
+  // Pins the thread running the core to cpu, if not negative, so benchmarks
+  // don't migrate between cores.
+  void SetCpuAffinity(int cpu) { cpu_affinity_ = cpu; }
+
+  // Where counters and gauges are written as JSON at the end of the run and
+  // where Prometheus snapshots of them are published every period while
+  // running, if not empty. See StatsExporter for the target format. Returns
+  // false if the exporter can't be set up.
+  bool SetStatsOutput(const std::string& json_path,
+                      const std::string& prometheus,
+                      std::chrono::milliseconds period);
+
   void Run();
   void Shutdown();
 
  private:
   void RegisterVideoDMA();
+  void RegisterStats();
+  // Seconds the core has been running, or ran for once it halted.
+  double RunSeconds() const;
 
   const uint32_t mem_size_bytes_;
   std::unique_ptr<uint32_t> mem_;
-  std::unique_ptr<CPU> cpu_;
-  std::unique_ptr<Core<MemoryBus>> core_;
+  std::unique_ptr<ComputerCore> core_;
   std::unique_ptr<VideoController> video_controller_;
   std::unique_ptr<InputController> input_controller_;
   std::unique_ptr<DiskController> disk_controller_;
-  SyncPoint video_signal_;
+  Doorbell video_signal_;
   SyncChan<uint32_t> timer_chan_;
   std::unique_ptr<TimerService> timer_service_;
   SyncChan<uint32_t> timer2_chan_;
   std::unique_ptr<TimerService> timer2_service_;
+  Doorbell blit_signal_;
+  std::unique_ptr<Blitter> blitter_;
+  std::unique_ptr<InputFifo> input_fifo_;
+  std::unique_ptr<SymbolMap> symbols_;
+  std::unique_ptr<Profiler> profiler_;
+  std::unique_ptr<EventLog> events_;
+  std::string instrumentation_path_;
+  int cpu_affinity_;
+  Stats stats_;
+  std::string stats_json_;
+  std::unique_ptr<StatsExporter> stats_exporter_;
+  int64_t run_start_;  // steady_clock ns, 0 before the core starts.
+  int64_t run_end_;    // steady_clock ns, 0 until the core halts.
+  uint64_t run_start_cycles_;  // HostCycles at run_start_.
+  uint64_t run_end_cycles_;    // HostCycles at run_end_.
 
 };
 
@@ -33,6 +33,9 @@
 namespace gvm {
 
 namespace {
+// Interrupt bit used for profiler sample requests.
+constexpr uint32_t kSampleInterrupt = 0x80;
+
 constexpr const uint32_t regv(const uint32_t idx, const uint32_t pc, uint32_t* regs) {
   if (idx < 30) return regs[idx];
   if (idx == 30) return pc;
@@ -79,37 +82,45 @@ constexpr const uint32_t reladdr21(const uint32_t v) {
 
 }  // namespace
 
-template <typename MEMORY>
-Core<MEMORY>::Core()
+template <typename MEMORY, typename INSTRUMENTATION>
+Core<MEMORY, INSTRUMENTATION>::Core()
     : pc_(reg_[kRegCount-2]), sp_(reg_[kRegCount-4]), fp_(reg_[kRegCount-3]),
-      op_count_(0), mask_interrupt_(false), interrupt_(0) {
+      op_count_(0), mask_interrupt_(false), interrupt_(0),
+      io_reg_(0xFFFFFFFF), events_(nullptr), replaying_(false),
+      replay_at_(EventLog::kNever), profiler_(nullptr), symbols_(nullptr) {
   std::memset(reg_, 0, kRegCount * sizeof(uint32_t));
 }
 
-template <typename MEMORY>
-void Core<MEMORY>::ConnectMemory(MEMORY mem, uint32_t user_ram_limit) {
+template <typename MEMORY, typename INSTRUMENTATION>
+void Core<MEMORY, INSTRUMENTATION>::ConnectMemory(
+    MEMORY mem, uint32_t user_ram_limit) {
   mem_ = mem;
   mem_.clear();
   user_ram_limit_ = user_ram_limit;
   fp_ = sp_ = user_ram_limit_;
 }
 
-template <typename MEMORY>
-void Core<MEMORY>::SetPC(const uint32_t pc) {
+template <typename MEMORY, typename INSTRUMENTATION>
+void Core<MEMORY, INSTRUMENTATION>::SetPC(const uint32_t pc) {
   assert(pc % kWordSize == 0);
   pc_ = pc;
   assert(pc_ < mem_.size());
 }
 
-template <typename MEMORY>
-uint64_t Core<MEMORY>::PowerOn() {
+template <typename MEMORY, typename INSTRUMENTATION>
+uint64_t Core<MEMORY, INSTRUMENTATION>::PowerOn() {
   Reset();
-  Run();
+  if (replaying_) {
+    replay_at_ = events_->next_interrupt();
+    Run<true>();
+  } else {
+    Run<false>();
+  }
   return op_count_;
 }
 
-template <typename MEMORY>
-uint64_t Core<MEMORY>::Reset() {
+template <typename MEMORY, typename INSTRUMENTATION>
+uint64_t Core<MEMORY, INSTRUMENTATION>::Reset() {
   mask_interrupt_ = true;
   const uint64_t op_count = op_count_;
   interrupt_ = 1;  // Mask out all interrupts and set bit 0 to 1, signaling reset.
@@ -117,43 +128,113 @@ uint64_t Core<MEMORY>::Reset() {
   return op_count;
 }
 
-template <typename MEMORY>
-void Core<MEMORY>::Timer() {
-  if (mask_interrupt_) return;
+template <typename MEMORY, typename INSTRUMENTATION>
+void Core<MEMORY, INSTRUMENTATION>::Timer() {
+  if (mask_interrupt_ || replaying_) return;
+  interrupt_stats_.Raise(0x02);
   interrupt_ |= 0x02;
   interrupt_event_.notify_all();
 }
 
-template <typename MEMORY>
-void Core<MEMORY>::Input() {
-  if (mask_interrupt_) return;
+template <typename MEMORY, typename INSTRUMENTATION>
+bool Core<MEMORY, INSTRUMENTATION>::Input() {
+  if (mask_interrupt_ || replaying_) return false;
+  interrupt_stats_.Raise(0x04);
   interrupt_ |= 0x04;
   interrupt_event_.notify_all();
+  return true;
 }
 
-template <typename MEMORY>
-void Core<MEMORY>::RecurringTimer() {
-  if (mask_interrupt_) return;
+template <typename MEMORY, typename INSTRUMENTATION>
+void Core<MEMORY, INSTRUMENTATION>::RecurringTimer() {
+  if (mask_interrupt_ || replaying_) return;
+  interrupt_stats_.Raise(0x08);
   interrupt_ |= 0x08;
   interrupt_event_.notify_all();
 }
 
-template <typename MEMORY>
-void Core<MEMORY>::Timer2() {
-  if (mask_interrupt_) return;
+template <typename MEMORY, typename INSTRUMENTATION>
+void Core<MEMORY, INSTRUMENTATION>::Timer2() {
+  if (mask_interrupt_ || replaying_) return;
+  interrupt_stats_.Raise(0x10);
   interrupt_ |= 0x10;
   interrupt_event_.notify_all();
 }
 
-template <typename MEMORY>
-void Core<MEMORY>::RecurringTimer2() {
-  if (mask_interrupt_) return;
+template <typename MEMORY, typename INSTRUMENTATION>
+void Core<MEMORY, INSTRUMENTATION>::RecurringTimer2() {
+  if (mask_interrupt_ || replaying_) return;
+  interrupt_stats_.Raise(0x20);
   interrupt_ |= 0x20;
   interrupt_event_.notify_all();
 }
 
-template <typename MEMORY>
-void Core<MEMORY>::Run() {
+template <typename MEMORY, typename INSTRUMENTATION>
+void Core<MEMORY, INSTRUMENTATION>::Video() {
+  if (mask_interrupt_ || replaying_) return;
+  interrupt_stats_.Raise(0x40);
+  interrupt_ |= 0x40;
+  interrupt_event_.notify_all();
+}
+
+template <typename MEMORY, typename INSTRUMENTATION>
+void Core<MEMORY, INSTRUMENTATION>::Sample() {
+  __atomic_fetch_or(&interrupt_, kSampleInterrupt, __ATOMIC_RELAXED);
+}
+
+template <typename MEMORY, typename INSTRUMENTATION>
+void Core<MEMORY, INSTRUMENTATION>::TakeSample(const uint32_t pc) {
+  Profiler::Sample* sample = profiler_->Begin();
+  if (sample == nullptr) return;
+  sample->pcs[0] = pc;
+  sample->depth = 1;
+  // Calls and interrupts save the caller's pc at fp+4 and its fp at fp.
+  uint32_t fp = fp_;
+  while (sample->depth < Profiler::kMaxDepth && fp < user_ram_limit_ &&
+         fp % kWordSize == 0) {
+    sample->pcs[sample->depth++] = mem_.Read(fp + 4);
+    const uint32_t next = mem_.Read(fp);
+    if (next <= fp) break;
+    fp = next;
+  }
+  profiler_->Commit();
+}
+
+template <typename MEMORY, typename INSTRUMENTATION>
+uint64_t Core<MEMORY, INSTRUMENTATION>::Digest(const uint32_t end) const {
+  // FNV-1a over the words.
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  const auto mix = [&hash](uint32_t word) {
+    hash = (hash ^ word) * 0x100000001b3ULL;
+  };
+  for (uint32_t i = 0; i < kRegCount; ++i) mix(reg_[i]);
+  for (uint32_t addr = 0; addr < end && addr < mem_.size(); addr += 4) {
+    mix(mem_.Read(addr));
+  }
+  return hash;
+}
+
+template <typename MEMORY, typename INSTRUMENTATION>
+template <bool REPLAY>
+uint32_t Core<MEMORY, INSTRUMENTATION>::DeviceRead(
+    const uint32_t addr, uint32_t value) {
+  if (REPLAY) {
+    value = events_->Replay(op_count_, addr, value);
+    replay_at_ = events_->next_interrupt();
+    return value;
+  }
+  if (addr == timer_reg_) {
+    value = timer_signal_->Elapsed();
+  } else if (perf_.Owns(addr)) {
+    value = perf_.Read(addr, op_count_);
+  }
+  if (events_ != nullptr) events_->Read(op_count_, addr, value);
+  return value;
+}
+
+template <typename MEMORY, typename INSTRUMENTATION>
+template <bool REPLAY>
+void Core<MEMORY, INSTRUMENTATION>::Run() {
   static void* opcodes[] = {
     &&NOP, &&HALT, &&LOAD_RI, &&LOAD_IX, &&LOAD_PC, &&LOAD_IXR, &&LOAD_PI,
     &&LOAD_IP, &&LDP_PI, &&LDP_IP, &&STOR_RI, &&STOR_IX, &&STOR_PC, &&STOR_PI,
@@ -166,40 +247,42 @@ void Core<MEMORY>::Run() {
   uint32_t pc = pc_-4;
   uint32_t word = 0;
 
+// Replays raise each logged interrupt when the count it was taken at comes.
 #define interrupt_dispatch() \
+  if (REPLAY && op_count_ == replay_at_) {\
+    __atomic_fetch_or(&interrupt_, events_->TakeInterrupt(), __ATOMIC_RELAXED);\
+    replay_at_ = events_->next_interrupt();\
+  }\
   if (interrupt_ == 0) {\
     pc += 4;\
     word =  mem_.Read(pc);\
     ++op_count_;\
+    instrumentation_.Op(pc, word, reg_);\
     goto *opcodes[word&0x3F];\
   }\
   goto INTERRUPT_SERVICE
 
-#ifdef DEBUG_DISPATCH
-#define DISPATCH() \
-    pc_ = pc; \
-    std::cerr << PrintInstruction(word) << std::endl; \
-    std::cerr << PrintRegisters(true) << std::endl;\
-    interrupt_dispatch()
-#else
 #define DISPATCH() interrupt_dispatch()
-#endif
 
 #define VSIG(addr) \
   if (addr == vram_reg_) {\
-    video_signal_->send();\
-    std::this_thread::yield();\
+    video_signal_->Ring();\
   }
 
 #define TIMER_READ(addr, v, fallback) \
   v = fallback; \
-  if (addr == timer_reg_) { \
-    v = timer_signal_->Elapsed();\
+  if (addr >= io_reg_) { \
+    v = DeviceRead<REPLAY>(addr, v);\
   }\
+  instrumentation_.Load(addr, v);
 
-#define TIMER_WRITE(addr, v) \
+// All device registers written to live at or above oneshot_reg_.
+#define IO_WRITE(addr, v) \
+  instrumentation_.Store(addr, v); \
   if (addr >= oneshot_reg_) { \
-    if (addr == oneshot_reg_) { \
+    if (REPLAY) { \
+      if (addr == blit_reg_ && replay_blit_) replay_blit_(); \
+    } else if (addr == oneshot_reg_) { \
       timer_signal_->OneShot(v); \
     } else if (addr == recurring_reg_) { \
       timer_signal_->Recurring(v); \
@@ -207,6 +290,10 @@ void Core<MEMORY>::Run() {
       timer2_signal_->OneShot(v); \
     } else if (addr == recurring2_reg_) { \
       timer2_signal_->Recurring(v); \
+    } else if (addr == blit_reg_) { \
+      blit_signal_->Ring(); \
+    } else if (addr == perf_.ctrl_reg()) { \
+      perf_.Control(v, op_count_); \
     } \
   }
 
@@ -214,6 +301,7 @@ void Core<MEMORY>::Run() {
   NOP:
       DISPATCH();
   HALT: {
+    pc_ = pc;
     return;
   }
   LOAD_RI: {
@@ -302,7 +390,7 @@ void Core<MEMORY>::Run() {
       const auto v = regv(reg1(word), pc, reg_);
       mem_.Write(addr) = v;
       VSIG(addr);
-      TIMER_WRITE(addr, v);
+      IO_WRITE(addr, v);
       DISPATCH();
   }
   STOR_IX: {
@@ -310,7 +398,7 @@ void Core<MEMORY>::Run() {
       const auto v = regv(reg2(word), pc, reg_);
       mem_.Write(addr) = v;
       VSIG(addr);
-      TIMER_WRITE(addr, v);
+      IO_WRITE(addr, v);
       DISPATCH();
   }
   STOR_PC: {
@@ -318,7 +406,7 @@ void Core<MEMORY>::Run() {
       const auto v = regv(reg1(word), pc, reg_);
       mem_.Write(addr) = v;
       VSIG(addr);
-      TIMER_WRITE(addr, v);
+      IO_WRITE(addr, v);
       DISPATCH();
   }
   STOR_PI: {
@@ -328,7 +416,7 @@ void Core<MEMORY>::Run() {
       mem_.Write(next) = v;
       reg_[idx] = next;
       VSIG(next);
-      TIMER_WRITE(next, v);
+      IO_WRITE(next, v);
       DISPATCH();
   }
   STOR_IP: {
@@ -339,7 +427,7 @@ void Core<MEMORY>::Run() {
       mem_.Write(cur) = v;
       reg_[idx] = next;
       VSIG(cur);
-      TIMER_WRITE(cur, v);
+      IO_WRITE(cur, v);
       DISPATCH();
   }
   STP_PI: {
@@ -348,11 +436,11 @@ void Core<MEMORY>::Run() {
       auto v = regv(reg2(word), pc, reg_);
       mem_.Write(next) = v;
       VSIG(next);
-      TIMER_WRITE(next, v);
+      IO_WRITE(next, v);
       v = regv(reg3(word), pc, reg_);
       mem_.Write(next+4) = v;
       VSIG(next+4);
-      TIMER_WRITE(next+4, v);
+      IO_WRITE(next+4, v);
       reg_[dest] = next;
       DISPATCH();
   }
@@ -362,11 +450,11 @@ void Core<MEMORY>::Run() {
       const uint32_t next = cur + ext11bit(word);
       auto v = regv(reg2(word), pc, reg_);
       mem_.Write(cur) = v;
-      TIMER_WRITE(cur, v);
+      IO_WRITE(cur, v);
       VSIG(cur);
       v  = regv(reg3(word), pc, reg_);
       mem_.Write(cur+4) = v;
-      TIMER_WRITE(cur+4, v);
+      IO_WRITE(cur+4, v);
       VSIG(cur+4);
       reg_[dest] = next;
       DISPATCH();
@@ -398,48 +486,80 @@ void Core<MEMORY>::Run() {
   }
   JMP:
       pc = pc + reladdr26(word >> 6) - 4;
+      instrumentation_.Block(pc + 4);
       DISPATCH();
-  JNE:
-      if (reg_[reg1(word)] != 0) pc = pc + reladdr21(word) - 4;
+  JNE: {
+      const bool taken = reg_[reg1(word)] != 0;
+      instrumentation_.Branch(ISA::JNE, taken);
+      if (taken) pc = pc + reladdr21(word) - 4;
+      instrumentation_.Block(pc + 4);
       DISPATCH();
-  JEQ:
-      if (reg_[reg1(word)] == 0) pc = pc + reladdr21(word) - 4;
+  }
+  JEQ: {
+      const bool taken = reg_[reg1(word)] == 0;
+      instrumentation_.Branch(ISA::JEQ, taken);
+      if (taken) pc = pc + reladdr21(word) - 4;
+      instrumentation_.Block(pc + 4);
       DISPATCH();
-  JGT:
-      if (static_cast<int32_t>(reg_[reg1(word)]) > 0) pc = pc + reladdr21(word) - 4;
+  }
+  JGT: {
+      const bool taken = static_cast<int32_t>(reg_[reg1(word)]) > 0;
+      instrumentation_.Branch(ISA::JGT, taken);
+      if (taken) pc = pc + reladdr21(word) - 4;
+      instrumentation_.Block(pc + 4);
       DISPATCH();
-  JGE:
-      if (static_cast<int32_t>(reg_[reg1(word)]) >= 0) pc = pc + reladdr21(word) - 4;
+  }
+  JGE: {
+      const bool taken = static_cast<int32_t>(reg_[reg1(word)]) >= 0;
+      instrumentation_.Branch(ISA::JGE, taken);
+      if (taken) pc = pc + reladdr21(word) - 4;
+      instrumentation_.Block(pc + 4);
       DISPATCH();
-  JLT:
-      if (static_cast<int32_t>(reg_[reg1(word)]) < 0) pc = pc + reladdr21(word) - 4;
+  }
+  JLT: {
+      const bool taken = static_cast<int32_t>(reg_[reg1(word)]) < 0;
+      instrumentation_.Branch(ISA::JLT, taken);
+      if (taken) pc = pc + reladdr21(word) - 4;
+      instrumentation_.Block(pc + 4);
       DISPATCH();
-  JLE:
-      if (static_cast<int32_t>(reg_[reg1(word)]) <= 0) pc = pc + reladdr21(word) - 4;
+  }
+  JLE: {
+      const bool taken = static_cast<int32_t>(reg_[reg1(word)]) <= 0;
+      instrumentation_.Branch(ISA::JLE, taken);
+      if (taken) pc = pc + reladdr21(word) - 4;
+      instrumentation_.Block(pc + 4);
       DISPATCH();
+  }
   CALLI:
+      instrumentation_.Call(pc);
       sp_ -= 4;
       mem_.Write(sp_) = pc;
       sp_ -= 4;
       mem_.Write(sp_) = fp_;
       fp_ = sp_;
       pc = pc + reladdr26(word >> 6) - 4;
+      instrumentation_.Block(pc + 4);
       DISPATCH();
   CALLR:
+      instrumentation_.Call(pc);
       sp_ -= 4;
       mem_.Write(sp_) = pc;
       sp_ -= 4;
       mem_.Write(sp_) = fp_;
       fp_ = sp_;
       pc = reg_[reg1(word)] - 4;
+      instrumentation_.Block(pc + 4);
       DISPATCH();
   RET:
+      instrumentation_.Ret();
+      interrupt_stats_.Ret(fp_);
       sp_ = fp_;
       fp_ = mem_.Read(sp_);
       sp_ += 4;
       pc = mem_.Read(sp_);
       sp_ += 4;
       mask_interrupt_ = false;
+      instrumentation_.Block(pc + 4);
       DISPATCH();
   AND_RR: {
       const uint32_t idx = reg1(word);
@@ -551,65 +671,103 @@ void Core<MEMORY>::Run() {
       DISPATCH();
   }
   WFI: {
-    // Wait on mutex.
-    {
-      std::unique_lock<std::mutex> ul(interrupt_mutex_);
-      interrupt_event_.wait(ul, [this]{return interrupt_ != 0;});
+    if (REPLAY) {
+      // The recorded run took an interrupt here, unless it ended waiting.
+      if (op_count_ != replay_at_) {
+        if (!events_->done()) events_->Diverge(op_count_, "wfi");
+        pc_ = pc;
+        return;
+      }
+    } else {
+      // Wait on mutex.
+      const uint64_t start = HostCycles();
+      {
+        std::unique_lock<std::mutex> ul(interrupt_mutex_);
+        interrupt_event_.wait(ul, [this]{
+          return (interrupt_ & ~kSampleInterrupt) != 0;
+        });
+      }
+      perf_.Wait(HostCycles() - start);
     }
     DISPATCH();
     return;
   }
 
   INTERRUPT_SERVICE: {
+    if (interrupt_ & kSampleInterrupt) {
+      __atomic_fetch_and(&interrupt_, ~kSampleInterrupt, __ATOMIC_RELAXED);
+      TakeSample(pc + 4);  // pc is incremented on DISPATCH.
+      // The profiler may have asked for another sample meanwhile, which the
+      // next dispatch takes.
+      if ((interrupt_ & ~kSampleInterrupt) == 0) {
+        DISPATCH();
+      }
+    }
     // If reset is set, we ignore every other signal and reset the cpu.
     if (interrupt_ & 0x01) {
+      if (!REPLAY && events_ != nullptr) events_->Interrupt(op_count_, 0x01);
       interrupt_ = 0;
+      interrupt_stats_.Reset();
       // We zero out all registers and setup pc, sp and fp accordingly.
       std::memset(reg_, 0, kRegCount * sizeof(uint32_t));
       fp_ = sp_ = user_ram_limit_;
       pc = pc_-4;
       mask_interrupt_ = false;
     } else {
-      mask_interrupt_ = true;
-      sp_ -= 4;
-      mem_.Write(sp_) = pc;
-      sp_ -= 4;
-      mem_.Write(sp_) = fp_;
-      fp_ = sp_;
-
-      // Process signals in bit order. Lower bits have higher priority than higher bits.
+      // Process signals in bit order. Lower bits have higher priority than
+      // higher bits. The handler pc is 4 bytes before the vector because it
+      // is incremented on DISPATCH.
+      uint32_t taken = 0;
+      uint32_t handler = 0;
       if (interrupt_ & 0x02) {
-        // Timer interrupt.
-        pc = 0x0;  // Set to 0 because it will be incremented to addr 0x04 on DISPATCH.
-        interrupt_ &= ~0x02;
+        // Timer interrupt, vector 0x04.
+        taken = 0x02;
+        handler = 0x0;
       } else if (interrupt_ & 0x04) {
-        // Input interrupt.
-        pc = 0x04;  // Set to 0x04 because it will be incremented to addr 0x08 on DISPATCH.
-        interrupt_ &= ~0x04;
+        // Input interrupt, vector 0x08.
+        taken = 0x04;
+        handler = 0x04;
       } else if (interrupt_ & 0x08) {
-        // Recurring timer interrupt.
-        pc = 0x08;  // Set to 0x08 because it will be incremented to addr 0x0c on DISPATCH.
-        interrupt_ &= ~0x08;
+        // Recurring timer interrupt, vector 0x0c.
+        taken = 0x08;
+        handler = 0x08;
       } else if (interrupt_ & 0x10) {
-        // Timer2 interrupt.
-        pc = 0x0c;  // Set to 0x0c because it will be incremented to addr 0x10 on DISPATCH.
-        interrupt_ &= ~0x10;
+        // Timer2 interrupt, vector 0x10.
+        taken = 0x10;
+        handler = 0x0c;
       } else if (interrupt_ & 0x20) {
-        // Recurring timer2 interrupt.
-        pc = 0x10;  // Set to 0x10 because it will be incremented to addr 0x14 on DISPATCH.
-        interrupt_ &= ~0x20;
+        // Recurring timer2 interrupt, vector 0x14.
+        taken = 0x20;
+        handler = 0x10;
       } else if (interrupt_ & 0x40) {
-        // Video interrupt.
-        pc = 0x14;  // Set to 0x14 because it will be incremented to addr 0x18 on DISPATH.
-        interrupt_ &= ~0x40;
+        // Video interrupt, vector 0x18.
+        taken = 0x40;
+        handler = 0x14;
+      }
+      // Only a device interrupt gets a frame, anything else just resumes.
+      if (taken != 0) {
+        mask_interrupt_ = true;
+        const uint32_t interrupted = pc + 4;  // pc is incremented on DISPATCH.
+        sp_ -= 4;
+        mem_.Write(sp_) = pc;
+        sp_ -= 4;
+        mem_.Write(sp_) = fp_;
+        fp_ = sp_;
+        pc = handler;
+        interrupt_ &= ~taken;
+        instrumentation_.Call(interrupted);
+        interrupt_stats_.Dispatch(taken, fp_);
+        perf_.Interrupt();
+        if (!REPLAY && events_ != nullptr) events_->Interrupt(op_count_, taken);
       }
     }
+    instrumentation_.Block(pc + 4);
     DISPATCH();
   }
 }
 
-template <typename MEMORY>
-const std::string Core<MEMORY>::PrintRegisters(bool hex) {
+template <typename MEMORY, typename INSTRUMENTATION>
+const std::string Core<MEMORY, INSTRUMENTATION>::PrintRegisters(bool hex) {
   std::stringstream ss;
 
   ss << "[";
@@ -625,11 +783,16 @@ const std::string Core<MEMORY>::PrintRegisters(bool hex) {
                  : ss << r;
   }
   ss << "]\n";
+  if (symbols_ != nullptr) {
+    ss << "pc 0x" << std::hex << pc_ << " in " << symbols_->Describe(pc_)
+       << "\n";
+  }
   return ss.str();
 }
 
-template <typename MEMORY>
-const std::string Core<MEMORY>::PrintMemory(uint32_t from, uint32_t to) {
+template <typename MEMORY, typename INSTRUMENTATION>
+const std::string Core<MEMORY, INSTRUMENTATION>::PrintMemory(
+    uint32_t from, uint32_t to) {
   assert(from <= to);
   assert(from % 4 == 0);
   assert(to % 4 == 0);
@@ -646,219 +809,10 @@ const std::string Core<MEMORY>::PrintMemory(uint32_t from, uint32_t to) {
   return ss.str();
 }
 
-template <typename MEMORY>
-std::string Core<MEMORY>::PrintInstruction(const Word word) {
-  std::ostringstream ss;
-  const auto opcode = word & 0x3F;
-  auto pc = pc_;
-  if (opcode == ISA::RET) {
-      pc += 4;
-  }
-  ss << "0x" << std::hex << pc << ": " << std::dec;
-
-  switch (opcode) {  // first 8 bits define the instruction.
-    case ISA::HALT:
-      ss << "halt";
-      break;
-
-    case ISA::NOP:
-      ss << "nop";
-      break;
-
-    case ISA::LOAD_RI:
-      ss << "load r" << reg1(word) << ", [0x" << std::hex << ((word >> 11) & 0x1FFFFF) << "]";
-      break;
-
-    case ISA::LOAD_IX:
-      ss << "load r" << reg1(word) << ", [r" << reg2(word) << ", 0x" << std::hex << v16bit(word) << "]";
-      break;
-
-    case ISA::LOAD_PC:
-      ss << "load r" << reg1(word) << ", [r29, 0x" << std::hex << reladdr21(word) << "]";
-      break;
-
-    case ISA::LOAD_IXR:
-      ss << "load r" << reg1(word) << ", [r" << reg2(word) << ", r" << reg3(word) << "]";
-      break;
-
-    case ISA::LOAD_IP:
-      ss << "load post inc r" << reg1(word) << ", [r" << reg2(word) << ", 0x" << std::hex << v16bit(word) << "]";
-      break;
-
-    case ISA::LOAD_PI:
-      ss << "load pre inc r" << reg1(word) << ", [r" << reg2(word) << ", 0x" << std::hex << v16bit(word) << "]";
-      break;
-
-    case ISA::LDP_PI:
-      ss << "load pre inc r" << reg1(word) << ", r" << reg2(word) << ", [r" << reg3(word) << ", 0x" << std::hex << ext11bit(word) << "]";
-      break;
-
-    case ISA::LDP_IP:
-      ss << "load post inc r" << reg1(word) << ", r" << reg2(word) << ", [r" << reg3(word) << ", 0x" << std::hex << ext11bit(word) << "]";
-      break;
-
-    case ISA::STOR_RI:
-      ss << "stor [0x" << std::hex << ((word >> 11) & 0x1FFFFF) << "], r" << std::dec << reg1(word);
-      break;
-
-    case ISA::STOR_IX:
-      ss << "stor [r" << reg1(word) << ", 0x" << std::hex << v16bit(word) << "], r" << std::dec << reg2(word);
-      break;
-
-    case ISA::STOR_PC:
-      ss << "stor [r29, 0x" << std::hex << reladdr21(word) << "], r" << std::dec << reg1(word);
-      break;
-
-    case ISA::STOR_IP:
-      ss << "stor post inc [r" << reg1(word) << ", 0x" << std::hex << ext16bit(word) << "], r" << std::dec << reg2(word);
-      break;
-
-    case ISA::STOR_PI:
-      ss << "stor pre inc [r" << reg1(word) << ", 0x" << std::hex << ext16bit(word) << "], r" << std::dec << reg2(word);
-      break;
-
-    case ISA::STP_PI:
-      ss << "stor pre inc [r" << reg1(word) << ", 0x" << std::hex << ext11bit(word) << "], r" << std::dec << reg2(word) << ", r" << reg3(word);
-      break;
-
-    case ISA::STP_IP:
-      ss << "stor post inc [r" << reg1(word) << ", 0x" << std::hex << ext11bit(word) << "], r" << std::dec << reg2(word) << ", r" << reg3(word);
-      break;
-
-    case ISA::ADD_RR:
-      ss << "add r" << reg1(word) << ", r" << reg2(word) << ", r" << reg3(word);
-      break;
-
-    case ISA::ADD_RI:
-      ss << "add r" << reg1(word) << ", r" << reg2(word) << ", 0x" << std::hex << v16bit(word);
-      break;
-
-    case ISA::SUB_RR:
-      ss << "sub r" << reg1(word) << ", r" << reg2(word) << ", r" << reg3(word);
-      break;
-
-    case ISA::SUB_RI:
-      ss << "sub r" << reg1(word) << ", r" << reg2(word) << ", 0x" << std::hex << v16bit(word);
-      break;
-
-    case ISA::JMP:
-      ss << "jmp 0x" << std::hex << pc;
-      break;
-
-    case ISA::JNE:
-      ss << "jne 0x" << std::hex << pc;
-      break;
-
-    case ISA::JEQ:
-      ss << "jeq 0x" << std::hex << pc;
-      break;
-    case ISA::JGT:
-      ss << "jgt 0x" << std::hex << pc;
-      break;
-
-    case ISA::JGE:
-      ss << "jge 0x" << std::hex << pc;
-      break;
-
-    case ISA::JLT:
-      ss << "jlt 0x" << std::hex << pc;
-      break;
-
-    case ISA::JLE:
-      ss << "jle 0x" << std::hex << pc;
-      break;
-
-    case ISA::CALLI:
-      ss << "call 0x" << std::hex << pc;
-      break;
-
-    case ISA::CALLR:
-      ss << "call [r" << reg1(word) << "]";
-      break;
-
-    case ISA::RET:
-      ss << "ret";
-      break;
-
-    case ISA::AND_RR:
-      ss << "and r" << reg1(word) << ", r" << reg2(word) << ", r" << reg3(word);
-      break;
-
-    case ISA::AND_RI:
-      ss << "and r" << reg1(word) << ", r" << reg2(word) << ", 0x" << std::hex << v16bit(word);
-      break;
-
-    case ISA::ORR_RR:
-      ss << "orr r" << reg1(word) << ", r" << reg2(word) << ", r" << reg3(word);
-      break;
-
-    case ISA::ORR_RI:
-      ss << "orr r" << reg1(word) << ", r" << reg2(word) << ", 0x" << std::hex << v16bit(word);
-      break;
-
-    case ISA::XOR_RR:
-      ss << "xor r" << reg1(word) << ", r" << reg2(word) << ", r" << reg3(word);
-      break;
-
-    case ISA::XOR_RI:
-      ss << "xor r" << reg1(word) << ", r" << reg2(word) << ", 0x" << std::hex << v16bit(word);
-      break;
-
-    case ISA::LSL_RR:
-      ss << "lsl r" << reg1(word) << ", r" << reg2(word) << ", r" << reg3(word);
-      break;
-
-    case ISA::LSL_RI:
-      ss << "lsl r" << reg1(word) << ", r" << reg2(word) << ", 0x" << std::hex << v16bit(word);
-      break;
-
-    case ISA::LSR_RR:
-      ss << "lsr r" << reg1(word) << ", r" << reg2(word) << ", r" << reg3(word);
-      break;
-
-    case ISA::LSR_RI:
-      ss << "lsr r" << reg1(word) << ", r" << reg2(word) << ", 0x" << std::hex << v16bit(word);
-      break;
-
-    case ISA::ASR_RR:
-      ss << "asr r" << reg1(word) << ", r" << reg2(word) << ", r" << reg3(word);
-      break;
-
-    case ISA::ASR_RI:
-      ss << "asr r" << reg1(word) << ", r" << reg2(word) << ", 0x" << std::hex << v16bit(word);
-      break;
-
-    case ISA::DIV_RI:
-      ss << "div r" << reg1(word) << ", r" << reg2(word) << ", 0x" << std::hex << v16bit(word);
-      break;
-
-    case ISA::DIV_RR:
-      ss << "div r" << reg1(word) << ", r" << reg2(word) << ", r" << reg3(word);
-      break;
-
-    case ISA::MUL_RI:
-      ss << "mul r" << reg1(word) << ", r" << reg2(word) << ", 0x" << std::hex << v16bit(word);
-      break;
-
-    case ISA::MUL_RR:
-      ss << "mul r" << reg1(word) << ", r" << reg2(word) << ", r" << reg3(word);
-      break;
-
-    case ISA::MULL_RR:
-      ss << "mull r" << reg1(word) << ", r" << reg2(word) << ", r" << reg3(word);
-      break;
-
-    case ISA::WFI:
-      ss << "wfi";
-      break;
-    default:
-      std::cerr << "Unrecognizd instrucation: "<< opcode << std::endl;
-      assert(false);
-      break;
-  }
-  return ss.str();
-}
-
-template class Core<MemoryBus>;
+template class Core<MemoryBus, NoInstrumentation>;
+template class Core<MemoryBus, OpcodeStats>;
+template class Core<MemoryBus, Tracer>;
+template class Core<MemoryBus, CallGraph>;
+template class Core<MemoryBus, Coverage>;
 
 }  // namespace gvm
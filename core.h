@@ -19,21 +19,31 @@
 #ifndef _GVM_CORE_H_
 #define _GVM_CORE_H_
 
+#include <algorithm>
 #include <condition_variable>
 #include <cstring>
+#include <functional>
 #include <mutex>
 #include <cstdint>
 #include <string>
 #include <vector>
 
+#include "event_log.h"
+#include "instrumentation.h"
+#include "interrupt_stats.h"
 #include "isa.h"
+#include "perf_counters.h"
+#include "profiler.h"
+#include "symbol_map.h"
 #include "sync_types.h"
 #include "timer.h"
 #include "video_controller.h"
 
 namespace gvm {
 
-template<typename MEMORY>
+// INSTRUMENTATION is called on every instruction and conditional jump. See
+// instrumentation.h.
+template<typename MEMORY, typename INSTRUMENTATION = NoInstrumentation>
 class Core {
  public:
   Core();
@@ -47,14 +57,29 @@ class Core {
   uint64_t PowerOn();
   uint64_t Reset();
 
-  // Sets signal for input handling.
-  void Input();
+  // Instructions run since power on. Can be read from other threads.
+  uint64_t InstructionCount() const {
+    return __atomic_load_n(&op_count_, __ATOMIC_RELAXED);
+  }
+
+  // Sets signal for input handling. Returns false if the interrupt was
+  // dropped because the guest is in a handler.
+  bool Input();
   void Timer();
   void RecurringTimer();
   void Timer2();
   void RecurringTimer2();
+  void Video();
+
+  // Asks for a profiler sample. Unlike the other signals it is never masked
+  // and doesn't run a guest handler.
+  void Sample();
+  void SetProfiler(Profiler* profiler) { profiler_ = profiler; }
+
+  // Used to name addresses in the Print functions.
+  void SetSymbols(const SymbolMap* symbols) { symbols_ = symbols; }
 
-  void SetVideoSignal(const uint32_t vram_reg, SyncPoint* video_signal) {
+  void SetVideoSignal(const uint32_t vram_reg, Doorbell* video_signal) {
     vram_reg_ = vram_reg;
     video_signal_ = video_signal;
   }
@@ -63,6 +88,7 @@ class Core {
       const uint32_t timer_reg, const uint32_t oneshot_reg,
       const uint32_t recurring_reg, TimerService* timer_signal) {
     timer_reg_ = timer_reg;
+    io_reg_ = std::min(io_reg_, timer_reg);
     oneshot_reg_ = oneshot_reg;
     recurring_reg_ = recurring_reg;
     timer_signal_ = timer_signal;
@@ -76,16 +102,54 @@ class Core {
     timer2_signal_ = timer_signal;
   }
 
+  // Guest visible performance counters. See perf_counters.h.
+  void SetPerfCounters(const uint32_t ctrl_reg, const uint32_t counters_reg) {
+    perf_.SetRegisters(ctrl_reg, counters_reg);
+  }
+
+  void SetBlitterSignal(const uint32_t head_reg, Doorbell* blit_signal) {
+    blit_reg_ = head_reg;
+    blit_signal_ = blit_signal;
+  }
+
+  // Records or, if events is replaying, replays the interrupts taken and the
+  // reads from device registers, which live at or above io_reg. A replaying
+  // core ignores device signals and never calls the timers, blit runs the
+  // blitter instead.
+  void SetEventLog(EventLog* events, uint32_t io_reg,
+                   std::function<void()> blit) {
+    events_ = events;
+    io_reg_ = std::min(io_reg_, io_reg);
+    replay_blit_ = blit;
+    replaying_ = events_ != nullptr && events_->replaying();
+  }
+
+  // Hash of the registers and of memory below end, used to compare runs.
+  uint64_t Digest(uint32_t end) const;
+
+  // Host cycles spent waiting in wfi. Can be read from other threads.
+  uint64_t WaitCycles() const { return perf_.wfi_cycles(); }
+
+  // Interrupt latency and handler duration, read once the core halted.
+  const InterruptStats& interrupt_stats() const { return interrupt_stats_; }
+
+  INSTRUMENTATION& instrumentation() { return instrumentation_; }
+  // Start before PowerOn, Stop once the core halted.
+  bool StartInstrumentation(const std::string& path) {
+    return instrumentation_.Start(path, symbols_);
+  }
+  void StopInstrumentation() { instrumentation_.Stop(reg_); }
+
   const std::string PrintRegisters(bool hex = false);
   const std::string PrintMemory(uint32_t from, uint32_t to);
   const std::string PrintStatusFlags();
 
  private:
-  void Run();
+  template <bool REPLAY> void Run();
+  template <bool REPLAY> uint32_t DeviceRead(uint32_t addr, uint32_t value);
   void InterruptService(uint32_t& pc);
   void SetPC(uint32_t pc);
-
-  std::string PrintInstruction(const Word word);
+  void TakeSample(uint32_t pc);
 
   uint32_t& pc_;
   MEMORY mem_;
@@ -99,7 +163,7 @@ class Core {
   std::mutex interrupt_mutex_;
   std::condition_variable interrupt_event_;
   uint32_t vram_reg_;
-  SyncPoint* video_signal_;
+  Doorbell* video_signal_;
   uint32_t timer_reg_;
   uint32_t oneshot_reg_;
   uint32_t recurring_reg_;
@@ -107,6 +171,18 @@ class Core {
   uint32_t oneshot2_reg_;
   uint32_t recurring2_reg_;
   TimerService* timer2_signal_;
+  uint32_t blit_reg_;
+  Doorbell* blit_signal_;
+  uint32_t io_reg_;
+  PerfCounters perf_;
+  InterruptStats interrupt_stats_;
+  EventLog* events_;
+  bool replaying_;
+  uint64_t replay_at_;
+  std::function<void()> replay_blit_;
+  Profiler* profiler_;
+  const SymbolMap* symbols_;
+  INSTRUMENTATION instrumentation_;
 
   typedef std::function<void(uint32_t, uint32_t&, bool&)> Handler;
   Handler handlers_[64];
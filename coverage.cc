@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "coverage.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace gvm {
+
+namespace {
+
+constexpr char kMagic[4] = {'G', 'V', 'M', 'C'};
+constexpr uint32_t kVersion = 1;
+
+}  // namespace
+
+constexpr uint32_t Coverage::kAddressSpace;
+constexpr char Coverage::kOutputOption[];
+
+Coverage::Coverage() : bits_(kAddressSpace / 4 / 32, 0) {}
+
+bool Coverage::Start(const std::string& path, const SymbolMap* symbols) {
+  path_ = path;
+  return true;
+}
+
+void Coverage::Stop(const uint32_t* regs) {
+  if (path_.empty()) return;
+  if (Write(path_, bits_)) {
+    uint32_t blocks = 0;
+    for (const uint32_t word : bits_) blocks += __builtin_popcount(word);
+    std::cerr << "Coverage: " << blocks << " block entries written to "
+              << path_ << "\n";
+  }
+}
+
+bool Coverage::Merge(const std::string& path, std::vector<uint32_t>* bits) {
+  std::ifstream in(path, std::ifstream::binary | std::ifstream::in);
+  CoverageHeader header;
+  if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion) {
+    std::cerr << path << " is not a version " << kVersion
+              << " coverage file\n";
+    return false;
+  }
+  std::vector<uint32_t> file(header.words);
+  if (!in.read(reinterpret_cast<char*>(file.data()),
+               file.size() * sizeof(uint32_t))) {
+    std::cerr << path << " is truncated\n";
+    return false;
+  }
+  if (bits->size() < file.size()) bits->resize(file.size(), 0);
+  for (size_t i = 0; i < file.size(); ++i) (*bits)[i] |= file[i];
+  return true;
+}
+
+bool Coverage::Write(const std::string& path,
+                     const std::vector<uint32_t>& bits) {
+  std::ofstream out(path, std::ofstream::binary | std::ofstream::out);
+  if (!out) {
+    std::cerr << "Unable to write coverage to " << path << "\n";
+    return false;
+  }
+  uint32_t words = bits.size();
+  while (words > 0 && bits[words - 1] == 0) --words;
+  CoverageHeader header = {};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.words = words;
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(bits.data()),
+            words * sizeof(uint32_t));
+  return static_cast<bool>(out);
+}
+
+}  // namespace gvm
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _GVM_COVERAGE_H_
+#define _GVM_COVERAGE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "symbol_map.h"
+
+namespace gvm {
+
+// Coverage is a Core instrumentation policy that marks the guest words where
+// execution continued after a jump, call, return or interrupt, in a bitmap
+// with one bit per word. Straight line code between those points isn't
+// marked: gvm-coverage recovers it from the rom, so the core only pays for
+// control transfers.
+//
+// A coverage file is a CoverageHeader followed by header.words bitmap words,
+// in host byte order. Bit n of word w stands for guest address
+// (w * 32 + n) * 4. Files are merged by or-ing their bitmaps.
+struct CoverageHeader {
+  char magic[4];  // "GVMC"
+  uint32_t version;
+  uint32_t words;
+};
+
+class Coverage {
+ public:
+  // Guest addresses tracked, enough for all of the computer's memory.
+  static constexpr uint32_t kAddressSpace = 32 << 20;
+  static constexpr char kOutputOption[] = "coverage_out";
+
+  Coverage();
+
+  void Op(uint32_t pc, uint32_t word, const uint32_t* regs) {}
+  void Branch(uint32_t opcode, bool taken) {}
+  void Load(uint32_t addr, uint32_t value) {}
+  void Store(uint32_t addr, uint32_t value) {}
+  void Call(uint32_t site) {}
+  void Ret() {}
+  void Block(uint32_t pc) {
+    if (pc < kAddressSpace) bits_[pc >> 7] |= 1u << ((pc >> 2) & 31);
+  }
+
+  // Remembers path, Stop writes the bitmap there.
+  bool Start(const std::string& path, const SymbolMap* symbols);
+  void Stop(const uint32_t* regs);
+
+  // Reads a coverage file into bits, growing it as needed and keeping the
+  // bits already set.
+  static bool Merge(const std::string& path, std::vector<uint32_t>* bits);
+  // Writes bits up to the last non zero word.
+  static bool Write(const std::string& path, const std::vector<uint32_t>& bits);
+
+ private:
+  std::vector<uint32_t> bits_;
+  std::string path_;
+};
+
+}  // namespace gvm
+
+#endif  // _GVM_COVERAGE_H_
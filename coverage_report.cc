@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// gvm-coverage merges the coverage files written by a coverage=1 build of gvm
+// with --coverage_out and maps them to source lines with the rom and the
+// symbol map written by gsm.
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "coverage.h"
+#include "cxxopts.hpp"
+#include "isa.h"
+#include "rom.h"
+#include "symbol_map.h"
+
+namespace {
+
+bool Marked(const std::vector<uint32_t>& bits, uint32_t addr) {
+  const uint32_t word = addr >> 7;
+  return word < bits.size() && (bits[word] & (1u << ((addr >> 2) & 31)));
+}
+
+// True for instructions after which execution doesn't fall through.
+bool EndsBlock(gvm::Word word) {
+  switch (word & 0x3F) {
+    case gvm::ISA::HALT:
+    case gvm::ISA::JMP:
+    case gvm::ISA::JNE:
+    case gvm::ISA::JEQ:
+    case gvm::ISA::JGT:
+    case gvm::ISA::JGE:
+    case gvm::ISA::JLT:
+    case gvm::ISA::JLE:
+    case gvm::ISA::CALLI:
+    case gvm::ISA::CALLR:
+    case gvm::ISA::RET:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Expands the marked block entries to every word run, following each block
+// to the instruction that ends it.
+std::vector<bool> Executed(const gvm::Rom& rom,
+                           const std::vector<uint32_t>& bits) {
+  std::vector<bool> executed(gvm::Coverage::kAddressSpace / gvm::kWordSize);
+  for (const auto& region : rom.Contents()) {
+    const uint32_t start = region.first;
+    const auto& words = region.second;
+    for (uint32_t i = 0; i < words.size(); ++i) {
+      if (!Marked(bits, start + i * gvm::kWordSize)) continue;
+      for (uint32_t j = i; j < words.size(); ++j) {
+        const uint32_t addr = start + j * gvm::kWordSize;
+        if (addr >= gvm::Coverage::kAddressSpace) break;
+        executed[addr / gvm::kWordSize] = true;
+        if (EndsBlock(words[j])) break;
+      }
+    }
+  }
+  return executed;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  cxxopts::Options options(
+      "gvm-coverage", "Merges GVM coverage files and reports line coverage.");
+  options.add_options()
+    ("coverage", "Coverage files written by gvm --coverage_out.",
+                 cxxopts::value<std::vector<std::string>>())
+    ("merge_out", "File where the merged coverage is written.",
+                  cxxopts::value<std::string>()->default_value(""))
+    ("rom", "Rom the coverage was collected with. Needed for line coverage.",
+            cxxopts::value<std::string>()->default_value(""))
+    ("symbols", "Symbol map written by gsm -s. Defaults to the rom file with "
+                "a .sym extension.",
+                cxxopts::value<std::string>()->default_value(""))
+    ("lcov", "File where line coverage is written in lcov format.",
+             cxxopts::value<std::string>()->default_value(""));
+  options.parse_positional({"coverage"});
+  auto result = options.parse(argc, argv);
+
+  if (!result.count("coverage")) {
+    std::cerr << "No coverage files given.\n";
+    return 1;
+  }
+  std::vector<uint32_t> bits;
+  for (const auto& path : result["coverage"].as<std::vector<std::string>>()) {
+    if (!gvm::Coverage::Merge(path, &bits)) return 1;
+  }
+
+  const std::string merge_out = result["merge_out"].as<std::string>();
+  if (!merge_out.empty() && !gvm::Coverage::Write(merge_out, bits)) {
+    return 1;
+  }
+
+  const std::string rom_path = result["rom"].as<std::string>();
+  if (rom_path.empty()) return 0;
+  std::ifstream in(rom_path, std::ifstream::binary | std::ifstream::in);
+  if (!in) {
+    std::cerr << "Unable to read rom " << rom_path << "\n";
+    return 1;
+  }
+  std::unique_ptr<const gvm::Rom> rom(gvm::Rom::FromFile(in));
+  std::string symbols_path = result["symbols"].as<std::string>();
+  if (symbols_path.empty()) {
+    const size_t dot = rom_path.rfind('.');
+    const size_t slash = rom_path.rfind('/');
+    const bool has_ext =
+        dot != std::string::npos && (slash == std::string::npos || dot > slash);
+    symbols_path = (has_ext ? rom_path.substr(0, dot) : rom_path) + ".sym";
+  }
+  gvm::SymbolMap symbols(symbols_path);
+
+  // Line numbers of each file and whether they ran.
+  const std::vector<bool> executed = Executed(*rom, bits);
+  std::map<std::string, std::map<uint32_t, bool>> files;
+  symbols.ForEachCodeLine([&executed, &files](
+      uint32_t start, uint32_t end, const std::string& location) {
+    const auto colon = location.rfind(':');
+    if (colon == std::string::npos) return;
+    bool& hit = files[location.substr(0, colon)][
+        std::stoul(location.substr(colon + 1))];
+    for (uint32_t addr = start; addr < end && !hit; addr += gvm::kWordSize) {
+      hit = addr < gvm::Coverage::kAddressSpace &&
+            executed[addr / gvm::kWordSize];
+    }
+  });
+  if (files.empty()) {
+    std::cerr << "No lines found in " << symbols_path << "\n";
+    return 1;
+  }
+
+  const std::string lcov_path = result["lcov"].as<std::string>();
+  std::ofstream lcov;
+  if (!lcov_path.empty()) {
+    lcov.open(lcov_path);
+    if (!lcov) {
+      std::cerr << "Unable to write " << lcov_path << "\n";
+      return 1;
+    }
+    lcov << "TN:\n";
+  }
+  uint32_t total = 0;
+  uint32_t total_hit = 0;
+  std::cout << std::fixed << std::setprecision(1);
+  for (const auto& file : files) {
+    uint32_t hit = 0;
+    if (lcov.is_open()) lcov << "SF:" << file.first << "\n";
+    for (const auto& line : file.second) {
+      if (line.second) ++hit;
+      if (lcov.is_open()) {
+        lcov << "DA:" << line.first << "," << (line.second ? 1 : 0) << "\n";
+      }
+    }
+    if (lcov.is_open()) {
+      lcov << "LF:" << file.second.size() << "\nLH:" << hit
+           << "\nend_of_record\n";
+    }
+    std::cout << file.first << ": " << hit << "/" << file.second.size()
+              << " lines (" << 100.0 * hit / file.second.size() << "%)\n";
+    total += file.second.size();
+    total_hit += hit;
+  }
+  std::cout << "total: " << total_hit << "/" << total << " lines ("
+            << 100.0 * total_hit / total << "%)\n";
+  return 0;
+}
@@ -73,6 +73,13 @@ class DiskController {
     chan_ = chan;
   }
 
+  // Disks attached, skipping empty slots.
+  size_t disk_count() const {
+    size_t count = 0;
+    for (const Disk* disk : disks_) count += disk != nullptr;
+    return count;
+  }
+
   void Start();
   void Stop() {
     chan_->send(0);
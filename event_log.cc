@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "event_log.h"
+
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+namespace gvm {
+
+namespace {
+
+constexpr char kMagic[4] = {'G', 'V', 'M', 'E'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kBufferSize = 1 << 20;
+
+}  // namespace
+
+constexpr uint32_t EventLog::kInterrupt;
+constexpr uint64_t EventLog::kNever;
+
+EventLog* EventLog::Record(const std::string& path) {
+  FILE* file = fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    std::cerr << "Unable to write event log " << path << "\n";
+    return nullptr;
+  }
+  setvbuf(file, nullptr, _IOFBF, kBufferSize);
+  EventLogHeader header = {};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  fwrite(&header, sizeof(header), 1, file);
+  return new EventLog(file, /*replaying=*/false);
+}
+
+EventLog* EventLog::Replay(const std::string& path) {
+  FILE* file = fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    std::cerr << "Unable to read event log " << path << "\n";
+    return nullptr;
+  }
+  setvbuf(file, nullptr, _IOFBF, kBufferSize);
+  EventLogHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1 ||
+      std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion) {
+    std::cerr << path << " is not a version " << kVersion << " event log\n";
+    fclose(file);
+    return nullptr;
+  }
+  EventLog* log = new EventLog(file, /*replaying=*/true);
+  log->Advance();
+  return log;
+}
+
+EventLog::EventLog(FILE* file, bool replaying)
+    : file_(file), replaying_(replaying), next_({kNever, 0, 0}), events_(0),
+      diverged_(false) {
+}
+
+EventLog::~EventLog() {
+  fclose(file_);
+}
+
+uint32_t EventLog::TakeInterrupt() {
+  const uint32_t bit = next_.value;
+  Advance();
+  return bit;
+}
+
+uint32_t EventLog::Replay(uint64_t count, uint32_t addr, uint32_t value) {
+  if (next_.count != count || next_.addr != addr) {
+    std::stringstream reason;
+    reason << "read of 0x" << std::hex << addr;
+    Diverge(count, reason.str());
+    return value;
+  }
+  value = next_.value;
+  Advance();
+  return value;
+}
+
+void EventLog::Diverge(uint64_t count, const std::string& reason) {
+  if (diverged_) return;
+  diverged_ = true;
+  std::cerr << "Replay diverged at instruction " << count << ": " << reason
+            << ", the log expected ";
+  if (done()) {
+    std::cerr << "no more events\n";
+  } else if (next_.addr == kInterrupt) {
+    std::cerr << "interrupt 0x" << std::hex << next_.value << std::dec
+              << " at instruction " << next_.count << "\n";
+  } else {
+    std::cerr << "a read of 0x" << std::hex << next_.addr << std::dec
+              << " at instruction " << next_.count << "\n";
+  }
+}
+
+void EventLog::Advance() {
+  if (fread(&next_, sizeof(next_), 1, file_) != 1) {
+    next_ = {kNever, 0, 0};
+    return;
+  }
+  ++events_;
+}
+
+}  // namespace gvm
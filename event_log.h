@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _GVM_EVENT_LOG_H_
+#define _GVM_EVENT_LOG_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace gvm {
+
+// EventLog holds what makes a run nondeterministic: the instruction count at
+// which each interrupt was taken and the value of every read from a device
+// register. A recorded log is replayed with the device threads stopped: the
+// core takes the same interrupts at the same instruction counts and reads the
+// same values, so the replay ends in the same state as the recorded run.
+//
+// The file is an EventLogHeader followed by Events in host byte order, in the
+// order they happened.
+struct EventLogHeader {
+  char magic[4];  // "GVME"
+  uint32_t version;
+};
+
+class EventLog {
+ public:
+  struct Event {
+    uint64_t count;  // Instructions run before the event.
+    uint32_t addr;   // Register read, kInterrupt for interrupts.
+    uint32_t value;  // Value read or interrupt bit taken.
+  };
+  static constexpr uint32_t kInterrupt = 0xFFFFFFFF;
+  static constexpr uint64_t kNever = UINT64_MAX;
+
+  // Both return nullptr if path can't be opened or isn't an event log.
+  static EventLog* Record(const std::string& path);
+  static EventLog* Replay(const std::string& path);
+
+  ~EventLog();
+
+  bool replaying() const { return replaying_; }
+
+  // Recording.
+  void Interrupt(uint64_t count, uint32_t bit) {
+    Append({count, kInterrupt, bit});
+  }
+  void Read(uint64_t count, uint32_t addr, uint32_t value) {
+    Append({count, addr, value});
+  }
+
+  // Replay. Instruction count of the next interrupt, kNever if the next event
+  // is a read or the log is over.
+  uint64_t next_interrupt() const {
+    return next_.addr == kInterrupt ? next_.count : kNever;
+  }
+  // Returns the next interrupt bit and moves past it.
+  uint32_t TakeInterrupt();
+  // Value read from addr by the instruction at count in the recorded run.
+  // Reports a divergence and returns value if the run took another path.
+  uint32_t Replay(uint64_t count, uint32_t addr, uint32_t value);
+  // True once every event was replayed.
+  bool done() const { return next_.count == kNever; }
+  bool diverged() const { return diverged_; }
+  // Reports that the replay can't go on at count, e.g. waiting for an
+  // interrupt the log doesn't have.
+  void Diverge(uint64_t count, const std::string& reason);
+
+  uint64_t events() const { return events_; }
+
+ private:
+  EventLog(FILE* file, bool replaying);
+
+  void Append(const Event& event) {
+    fwrite(&event, sizeof(event), 1, file_);
+    ++events_;
+  }
+  // Loads the event after next_.
+  void Advance();
+
+  FILE* file_;
+  const bool replaying_;
+  Event next_;
+  uint64_t events_;
+  bool diverged_;
+};
+
+}  // namespace gvm
+
+#endif  // _GVM_EVENT_LOG_H_
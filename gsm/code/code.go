@@ -275,10 +275,14 @@ func writeObject(ast *parser.AST, name string, allObjs map[string]*object, buf *
 							}
 							nb += uint32(len(bytes))
 						} else if len(statement.Blob) > 0 {
-							if _, err := buf.Write(statement.Blob); err != nil {
+							// Pad to a whole word, as WordCount does, so the
+							// following words stay at their label addresses.
+							bytes := make([]byte, (len(statement.Blob)+3)/4*4)
+							copy(bytes, statement.Blob)
+							if _, err := buf.Write(bytes); err != nil {
 								return err
 							}
-							nb += uint32(len(statement.Blob))
+							nb += uint32(len(bytes))
 						} else {
 							if statement.Label != "" {
 								return statement.Errorf("unresolved reference to %q", statement.Label)
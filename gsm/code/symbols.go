@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+package code
+
+import (
+	"bufio"
+	"fmt"
+	"strings"
+
+	"github.com/avalonbits/gsm/parser"
+)
+
+// WriteSymbols writes a symbol map for the program in ast, which must have gone
+// through GenerateFromObject. It has one record per line with addresses in hex:
+//
+//	section <start> <end> <text|data> <file>
+//	func <start> <end> <name>
+//	label <addr> <name>
+//	line <start> <end> <file>:<line>
+//
+// Ranges are [start, end). Names are qualified with the include name of the
+// file they were defined in.
+func WriteSymbols(ast *parser.AST, buf *bufio.Writer) error {
+	defer buf.Flush()
+
+	for _, org := range ast.Orgs {
+		if org.Sections == nil {
+			continue
+		}
+		addr := org.Addr
+		for section := org.Sections; ; section = section.Next {
+			var size uint32
+			for _, block := range section.Blocks {
+				size += uint32(block.WordCount() * 4)
+			}
+			sType := "text"
+			if section.Type == parser.DATA_SECTION {
+				sType = "data"
+			}
+			if _, err := fmt.Fprintf(buf, "section %x %x %s %s\n",
+				addr, addr+size, sType, section.File); err != nil {
+				return err
+			}
+
+			fn := ""
+			var fnStart uint32
+			for _, block := range section.Blocks {
+				if fn != "" && block.FuncName() != fn {
+					if err := writeFunc(buf, fnStart, addr, section.IncludeName, fn); err != nil {
+						return err
+					}
+					fn = ""
+				}
+				if fn == "" && block.FuncName() != "" {
+					fn = block.FuncName()
+					fnStart = addr
+				}
+
+				if block.Label != "" {
+					name := block.Label
+					if fn != "" && block.Label != fn {
+						name = fn + "." + block.Label
+					}
+					if _, err := fmt.Fprintf(buf, "label %x %s\n",
+						addr, symbolName(section.IncludeName, name)); err != nil {
+						return err
+					}
+				}
+
+				for _, statement := range block.Statements {
+					n := uint32(statement.WordCount() * 4)
+					if statement.Line() > 0 {
+						if _, err := fmt.Fprintf(buf, "line %x %x %s:%d\n",
+							addr, addr+n, section.File, statement.Line()); err != nil {
+							return err
+						}
+					}
+					addr += n
+				}
+			}
+			if fn != "" {
+				if err := writeFunc(buf, fnStart, addr, section.IncludeName, fn); err != nil {
+					return err
+				}
+			}
+
+			if section.Next == org.Sections {
+				break
+			}
+		}
+	}
+	return nil
+}
+
+func writeFunc(buf *bufio.Writer, start, end uint32, incl, fn string) error {
+	_, err := fmt.Fprintf(buf, "func %x %x %s\n", start, end, symbolName(incl, fn))
+	return err
+}
+
+// symbolName qualifies name with the include name, leaving out the root file.
+func symbolName(incl, name string) string {
+	incl = strings.TrimPrefix(strings.TrimPrefix(incl, "__root"), ".")
+	if incl == "" {
+		return name
+	}
+	return incl + "." + name
+}
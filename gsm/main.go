@@ -31,6 +31,7 @@ import (
 
 var (
 	outFile = flag.String("o", "a.rom", "Name of output file.")
+	symFile = flag.String("s", "", "Name of the symbol map file. Not written if empty.")
 )
 
 func main() {
@@ -47,6 +48,15 @@ func main() {
 	}
 	defer out.Close()
 
+	var sym *os.File
+	if *symFile != "" {
+		sym, err = os.Create(*symFile)
+		if err != nil {
+			panic(err)
+		}
+		defer sym.Close()
+	}
+
 	in, err := os.Open(flag.Arg(0))
 	if err != nil {
 		panic(err)
@@ -61,7 +71,8 @@ func main() {
 		}
 	}
 
-	ast, err := parser.Parse(in)
+	// File names in the symbol map are relative to the directory of the file.
+	ast, err := parser.Parse(in, filepath.Base(flag.Arg(0)))
 	if err != nil {
 		panic(err)
 	}
@@ -69,4 +80,10 @@ func main() {
 	if err := code.GenerateFromObject(ast, bufio.NewWriter(out)); err != nil {
 		panic(err)
 	}
+
+	if sym != nil {
+		if err := code.WriteSymbols(ast, bufio.NewWriter(sym)); err != nil {
+			panic(err)
+		}
+	}
 }
@@ -32,17 +32,18 @@ import (
 	"github.com/avalonbits/gsm/lexer"
 )
 
-func ParseLibrary(in io.Reader, name string) (*AST, error) {
-	return parse(in, name, true)
+func ParseLibrary(in io.Reader, name, file string) (*AST, error) {
+	return parse(in, name, file, true)
 }
 
-func Parse(in io.Reader) (*AST, error) {
-	return parse(in, "__root", false)
+func Parse(in io.Reader, file string) (*AST, error) {
+	return parse(in, "__root", file, false)
 }
 
-func parse(in io.Reader, name string, requireLibrary bool) (*AST, error) {
+func parse(in io.Reader, name, file string, requireLibrary bool) (*AST, error) {
 	lex := lexer.New(in)
 	p := New(name, lex)
+	p.File = file
 	if err := p.Parse(requireLibrary); err != nil {
 		return nil, err
 	}
@@ -74,9 +75,10 @@ func (o *Org) activeSection() *Section {
 	return o.Sections.Prev
 }
 
-func (o *Org) newSection() *Section {
+func (o *Org) newSection(file string) *Section {
 	sec := &Section{
 		IncludeName: o.Name,
+		File:        file,
 		Blocks:      make([]Block, 0, 8),
 	}
 	sec.Next = sec
@@ -140,6 +142,11 @@ func (s Statement) Errorf(format string, a ...interface{}) error {
 	return errors.New(fmt.Sprintf("line %d: %s", s.lineNum, fmt.Sprintf(format, a...)))
 }
 
+// Line is the source line the statement was read from.
+func (s Statement) Line() int {
+	return s.lineNum
+}
+
 func (s Statement) WordCount() int {
 	if s.ArraySize > 0 {
 		sz := s.ArraySize / 4
@@ -158,6 +165,10 @@ func (s Statement) WordCount() int {
 		return sz / 4
 	}
 
+	if len(s.Blob) > 0 {
+		return (len(s.Blob) + 3) / 4
+	}
+
 	return 1
 }
 
@@ -240,6 +251,11 @@ func (b Block) Errorf(format string, a ...interface{}) error {
 	return fmt.Errorf(format, a...)
 }
 
+// FuncName is the name of the function the block is part of, if any.
+func (b Block) FuncName() string {
+	return b.funcName
+}
+
 func (b Block) LabelName(incl string) string {
 	return b.JumpName(incl, b.Label)
 }
@@ -276,6 +292,7 @@ type Section struct {
 	Type        SType
 	Blocks      []Block
 	IncludeName string
+	File        string
 	Prev        *Section
 	Next        *Section
 }
@@ -310,6 +327,7 @@ type Tokenizer interface {
 
 type Parser struct {
 	Name      string
+	File      string
 	tokenizer Tokenizer
 	err       error
 	Ast       *AST
@@ -481,7 +499,7 @@ func (p *Parser) section() error {
 
 	// For every new .section entry, we reserve memory for 8 blocks.
 	o := p.activeOrg()
-	s := o.newSection()
+	s := o.newSection(p.File)
 
 	if tok.Type == lexer.S_DATA {
 		s.Type = DATA_SECTION
@@ -765,8 +783,10 @@ func (p *Parser) include() error {
 		}()
 	}
 
-	// Parse the file, producing an AST.
-	ast, err := ParseLibrary(in, p.Name+"."+tok.Literal)
+	// Parse the file, producing an AST. Its file name is kept relative to the
+	// root file so symbol maps can point at it.
+	file := filepath.Join(filepath.Dir(p.File), includeStr)
+	ast, err := ParseLibrary(in, p.Name+"."+tok.Literal, file)
 	if err != nil {
 		return err
 	}
@@ -849,7 +869,7 @@ func (p *Parser) embed() error {
 		return err
 	}
 
-	section := o.newSection()
+	section := o.newSection(filepath.Join(filepath.Dir(p.File), embedStr))
 	section.Type = DATA_SECTION
 	section.Blocks = []Block{
 		{
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _GVM_HISTOGRAM_H_
+#define _GVM_HISTOGRAM_H_
+
+#include <cstdint>
+#include <cstring>
+
+namespace gvm {
+
+// Histogram counts values in log-linear buckets: exact below 16, then 16
+// buckets per power of two, so percentiles are within ~6% of the real
+// value. It is not thread safe.
+class Histogram {
+ public:
+  static constexpr int kBuckets = 16 + 60 * 16;
+
+  Histogram() { Clear(); }
+
+  void Add(uint64_t value) {
+    ++counts_[Bucket(value)];
+    ++count_;
+    sum_ += value;
+    if (value > max_) max_ = value;
+  }
+
+  void Clear() {
+    memset(counts_, 0, sizeof(counts_));
+    count_ = 0;
+    sum_ = 0;
+    max_ = 0;
+  }
+
+  // Returns an upper bound for the p-th percentile, 0 < p <= 100.
+  uint64_t Percentile(double p) const {
+    if (count_ == 0) return 0;
+    uint64_t target = static_cast<uint64_t>(p / 100.0 * count_ + 0.5);
+    if (target == 0) target = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < kBuckets; ++b) {
+      seen += counts_[b];
+      if (seen >= target) {
+        const uint64_t limit = BucketLimit(b);
+        return limit < max_ ? limit : max_;
+      }
+    }
+    return max_;
+  }
+
+  uint64_t count() const { return count_; }
+  uint64_t sum() const { return sum_; }
+  uint64_t max() const { return max_; }
+  double mean() const {
+    return count_ == 0 ? 0 : sum_ / static_cast<double>(count_);
+  }
+
+ private:
+  static int Bucket(uint64_t value) {
+    if (value < 16) return static_cast<int>(value);
+    const int e = 63 - __builtin_clzll(value);
+    return 16 + (e - 4) * 16 + static_cast<int>((value >> (e - 4)) & 15);
+  }
+
+  // Largest value that falls in bucket b.
+  static uint64_t BucketLimit(int b) {
+    if (b < 16) return b;
+    const int e = (b - 16) / 16 + 4;
+    const uint64_t sub = (b - 16) % 16;
+    return ((16 + sub) << (e - 4)) + ((1ULL << (e - 4)) - 1);
+  }
+
+  uint64_t counts_[kBuckets];
+  uint64_t count_;
+  uint64_t sum_;
+  uint64_t max_;
+};
+
+}  // namespace gvm
+
+#endif  // _GVM_HISTOGRAM_H_
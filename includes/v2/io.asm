@@ -18,6 +18,14 @@
 
 .section data
 input_value_addr: .int 0x1200404
+input_head_addr:  .int 0x1200454
+input_tail_addr:  .int 0x1200458
+input_fifo_addr:  .int 0x1200600
+	; The input fifo holds 64 events of 2 words each: the value and the event
+	; type in bits 28-31 (1: key down, 2: key up, 3: text, 4: quit, 5: mouse
+	; motion, 6: mouse button, 7: joystick axis, 8: joystick button).
+	; The host advances the head and we advance the tail.
+
 	; struct input_buffer. Defines 32 key long circular buffer.
 	.equ ib_buffer       0
 	.equ ib_head        128  ; 32 * 4.
@@ -28,48 +36,69 @@ input_buffer: .array 136
 .section text
 
 ; ==== Input interrupt handler
-; The input interrupt handler adds ew key inputs to the circular buffer. If the
+; The input interrupt handler drains the input fifo, adding key and text
+; values to the circular buffer. One interrupt can carry many events. If the
 ; buffer is full, the input buffer is overwritten.
 @func input_handler:
-    ; Save the contents of r0 and r2 on the stack so we don't disrupt user code.
+    ; Save the registers we use on the stack so we don't disrupt user code.
     stppi [sp, -8], r0, r2
-
-    ; Read the value from the input.
-    ldr r2, [input_value_addr]
-    ldr r2, [r2]
-
-    ; Quit is the value 0xFFFFFFFF so adding 1 should result in 0.
-    add r0, r2, 1
-    jeq r0, quit
-
-	; Save r1 and r3 to the stack.
 	stppi [sp, -8], r1, r3
+	stppi [sp, -8], r4, r5
 
-	; Load input buffer.
-	mov r0, input_buffer
+	; r1: fifo tail, r4: tail register address, r5: fifo address.
+	ldr r4, [input_tail_addr]
+	ldr r1, [r4]
+	ldr r5, [input_fifo_addr]
 
-    ; Load the buffer tail and write.
-	ldri r1, [r0, ib_tail]
+next_event:
+	; The fifo is empty when the tail reaches the head.
+	ldr r2, [input_head_addr]
+	ldr r2, [r2]
+	sub r2, r2, r1
+	jeq r2, drained
 
-	; Because we operate with words, we need to multiply r1 by 4.
-	lsl r3, r1, 2
-	add r3, r0, r3
-	str [r3], r2
+	; Events are 8 bytes long. Read the value to r2 and the type to r3.
+	lsl r3, r1, 3
+	ldri r2, [r5, r3]
+	add r3, r3, 4
+	ldri r3, [r5, r3]
+	lsr r3, r3, 28
 
-	; Update the tail
+	; Hand the slot back to the host, wrapping after 64 events.
 	add r1, r1, 1
+	and r1, r1, 63
+	str [r4], r1
+
+	; Only key and text events (types 1 to 3) go to the buffer.
+	sub r3, r3, 4
+	jlt r3, buffer_key
+
+	; Quit is type 4 with the value 0xFFFFFFFF, so adding 1 results in 0.
+	; Other types can carry that value, e.g. a mouse motion of -1, -1.
+	jne r3, next_event
+	add r0, r2, 1
+	jeq r0, quit
+	jmp next_event
+
+buffer_key:
+	; Load input buffer and the buffer tail, as a byte offset, then write.
+	mov r0, input_buffer
+	ldri r3, [r0, ib_tail]
+	lsl r3, r3, 2
+	add r0, r0, r3
+	str [r0], r2
+
+	; Update the tail, wrapping around at 32 keys.
+	add r3, r3, 4
+	and r3, r3, 127
+	lsr r3, r3, 2
+	mov r0, input_buffer
+	stri [r0, ib_tail], r3
+	jmp next_event
 
-	; If it is not 32, then just write it back and be done.
-	sub r3, r1, 32
-	jne r3, done
-
-	; Need to wrap around.
-	mov r1, 0
-
-done:
-	stri [r0, ib_tail], r1
-
+drained:
     ; Input processing done. Restore registers and return.
+	ldpip r4, r5, [sp, 8]
 	ldpip r1, r3, [sp, 8]
     ldpip r0, r2, [sp, 8]
     ret
@@ -31,6 +31,8 @@ fg_color: .int 0
 bg_color: .int 0
 cursor_x: .int 0
 cursor_y: .int 0
+first_row: .int 0
+first_row_reg: .int 0x1200438
 .section text
 
 ; ==== Init: Initializes textmode.
@@ -42,6 +44,9 @@ cursor_y: .int 0
 	str [bg_color], rZ
 	str [cursor_x], rZ
 	str [cursor_y], rZ
+	str [first_row], rZ
+	ldr r1, [first_row_reg]
+	str [r1], rZ
 	call clear
 
 	; Loop to make sure the video was initialized.
@@ -187,6 +192,14 @@ done:
     ; r5: Character unicode value.
 
 	ldr r6, [framebuffer_start]
+    ; The framebuffer is a ring of rows and screen row 0 is at first_row.
+    ldr r7, [first_row]
+    add r2, r2, r7
+    sub r7, r2, 28
+    jlt r7, ring_row
+    mov r2, r7
+
+ring_row:
     ; We calculate position in framebuffer using the formula
     ; pos(x,y) x*4 + frame_buffer + y * 400
     lsl r1, r1, 2
@@ -214,6 +227,14 @@ done:
     ; r5: Pointer null-terminated string buffer.
 
 	ldr r6, [framebuffer_start]
+    ; The framebuffer is a ring of rows and screen row 0 is at first_row.
+    ldr r7, [first_row]
+    add r2, r2, r7
+    sub r7, r2, 28
+    jlt r7, ring_row
+    mov r2, r7
+
+ring_row:
     ; We calculate position in framebuffer using the formula
     ; pos(x,y) x*4 + frame_buffer + y * 400
     lsl r1, r1, 2
@@ -221,6 +242,10 @@ done:
     add r6, r6, r1
     add r6, r6, r2
 
+    ; Text past the end of the last ring row wraps to ring row 0.
+    ldr r8, [framebuffer_start]
+    add r8, r8, 11200
+
 string_loop:
 	ldr r7, [r5]
     and r0, r7, 0xFFFF
@@ -242,6 +267,11 @@ string_loop:
 
 	; Ok, still has characters. Advance the frame buffer.
 	add r6, r6, 4
+	sub r9, r6, r8
+	jlt r9, second_char
+	sub r6, r6, 11200
+
+second_char:
 
 	; Write the character
     orr r0, r0, r3
@@ -251,6 +281,9 @@ string_loop:
 	; Advance the frame and string buffers and start over.
 	add r5, r5, 4
 	add r6, r6, 4
+	sub r9, r6, r8
+	jlt r9, string_loop
+	sub r6, r6, 11200
 	jmp string_loop
 
 done:
@@ -300,7 +333,8 @@ done:
 	sub r3, r2, 28
 	jlt r3, done_y
 
-	; For now we will keep wrapping back to the last line.
+	; We are past the last line, so scroll the screen and stay on it.
+	call _scroll
 	mov r1, 0
 	mov r2, 27
 
@@ -314,6 +348,31 @@ done:
 	ret
 @endf _advance_cursor
 
+@infunc _scroll:
+	; Scrolls the screen up one line by moving the first row of the ring. The
+	; row that was on top becomes the last line, so it is cleared first.
+	ldr r1, [framebuffer_start]
+	ldr r2, [first_row]
+	mul r2, r2, 400
+	add r1, r1, r2
+	mov r2, 100
+	ldr r3, [bg_color]
+	ldr r4, [MEMSET4]
+	call r4
+
+	ldr r2, [first_row]
+	add r2, r2, 1
+	sub r3, r2, 28
+	jlt r3, done
+	mov r2, 0
+
+done:
+	str [first_row], r2
+	ldr r3, [first_row_reg]
+	str [r3], r2
+	ret
+@endf _scroll
+
 .section data
 vram_reg: .int 0x1200400
 
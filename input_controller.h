@@ -23,17 +23,48 @@
 #include <stdint.h>
 
 namespace gvm {
+
+// Input event types. Key values are key codes, with bit 31 set on key up.
+// Text values are unicode codepoints.
+constexpr uint32_t kInputKeyDown = 1;
+constexpr uint32_t kInputKeyUp = 2;
+constexpr uint32_t kInputText = 3;
+constexpr uint32_t kInputQuit = 4;
+// Relative motion: signed dx in bits 0-15 and dy in bits 16-31.
+constexpr uint32_t kInputMouseMotion = 5;
+// Button number in bits 0-7, bit 31 set on release.
+constexpr uint32_t kInputMouseButton = 6;
+// Signed axis value in bits 0-15, axis in bits 16-23, joystick in bits 24-30.
+constexpr uint32_t kInputJoyAxis = 7;
+// Button in bits 0-7, joystick in bits 24-30, bit 31 set on release.
+constexpr uint32_t kInputJoyButton = 8;
+
+// InputController reads user input on its own thread and hands every event to
+// the callback.
 class InputController {
  public:
-  explicit InputController(std::function<void(uint32_t value)> callback);
-  ~InputController();
+  InputController() : shutdown_(false) {}
+  virtual ~InputController() {}
+
+  void SetCallback(
+      std::function<void(uint32_t type, uint32_t value)> callback) {
+    callback_ = callback;
+  }
+
+  // Returns the number of instructions the guest has run. Lets input be
+  // timed in guest instructions.
+  void SetInstructionCounter(std::function<uint64_t()> counter) {
+    instructions_ = counter;
+  }
 
-  void Read();
-  void Shutdown() { shutdown_ = true; }
+  // Reads input until Shutdown is called.
+  virtual void Read() = 0;
+  virtual void Shutdown() { shutdown_ = true; }
 
- private:
+ protected:
   volatile bool shutdown_;
-  std::function<void(uint32_t value)> callback_;
+  std::function<void(uint32_t type, uint32_t value)> callback_;
+  std::function<uint64_t()> instructions_;
 };
 
 }  // namepsace gvm
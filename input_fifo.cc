@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "input_fifo.h"
+
+#include <cassert>
+
+#include "input_controller.h"
+#include "isa.h"
+
+namespace gvm {
+
+constexpr uint32_t InputFifo::kEventWords;
+constexpr std::chrono::microseconds InputFifo::kRetryPeriod;
+
+InputFifo::InputFifo(uint32_t* mem)
+    : mem_(mem), ring_(0), size_(0), head_reg_(0), tail_reg_(0),
+      start_(std::chrono::steady_clock::now()), motion_pending_(false),
+      motion_dx_(0), motion_dy_(0), motion_info_(0), batch_valid_(false),
+      batch_slot_(0), pushed_(0), raised_pushed_(0),
+      raise_pending_(false), shutdown_(false) {
+  assert(mem_ != nullptr);
+}
+
+void InputFifo::SetRegisters(uint32_t ring, uint32_t size, uint32_t head_reg,
+                             uint32_t tail_reg) {
+  ring_ = ring / kWordSize;
+  size_ = size;
+  head_reg_ = head_reg / kWordSize;
+  tail_reg_ = tail_reg / kWordSize;
+}
+
+void InputFifo::Push(uint32_t type, uint32_t value) {
+  const auto now = std::chrono::steady_clock::now();
+  const uint32_t us = std::chrono::duration_cast<std::chrono::microseconds>(
+      now - start_).count();
+  const uint32_t info = (type << 28) | (us & 0x0FFFFFFF);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    __atomic_store_n(&pushed_, pushed_ + 1, __ATOMIC_RELAXED);
+    if (type == kInputMouseMotion) {
+      motion_dx_ += static_cast<int16_t>(value & 0xFFFF);
+      motion_dy_ += static_cast<int16_t>(value >> 16);
+      motion_info_ = info;
+      motion_pending_ = true;
+    } else if (type == kInputJoyAxis) {
+      const uint32_t axis = value & 0xFFFF0000;
+      auto last = axes_last_.find(axis);
+      if (last != axes_last_.end() && last->second == value) {
+        axes_pending_.erase(axis);
+      } else {
+        axes_pending_[axis] = {value, info};
+      }
+    } else {
+      FlushCoalesced();
+      backlog_.push_back({value, info});
+    }
+  }
+  signal_.Ring();
+}
+
+static uint32_t Clamp16(int32_t v) {
+  if (v > 32767) v = 32767;
+  if (v < -32768) v = -32768;
+  return static_cast<uint32_t>(v) & 0xFFFF;
+}
+
+void InputFifo::FlushCoalesced() {
+  if (motion_pending_ && (motion_dx_ != 0 || motion_dy_ != 0)) {
+    backlog_.push_back(
+        {Clamp16(motion_dx_) | (Clamp16(motion_dy_) << 16), motion_info_});
+  }
+  motion_pending_ = false;
+  motion_dx_ = 0;
+  motion_dy_ = 0;
+  for (const auto& kv : axes_pending_) {
+    backlog_.push_back(kv.second);
+    axes_last_[kv.first] = kv.second.value;
+  }
+  axes_pending_.clear();
+}
+
+void InputFifo::Start() {
+  start_ = std::chrono::steady_clock::now();
+  next_interrupt_ = start_;
+  while (!shutdown_) {
+    if (Deliver()) {
+      signal_.WaitUntil(std::chrono::steady_clock::now() + kRetryPeriod);
+    } else {
+      signal_.Wait();
+    }
+  }
+}
+
+void InputFifo::Stop() {
+  shutdown_ = true;
+  signal_.Close();
+}
+
+bool InputFifo::MoveBacklog(uint32_t* head, uint32_t tail) {
+  bool moved = false;
+  while (!backlog_.empty() && (*head + 1) % size_ != tail) {
+    const Event& event = backlog_.front();
+    mem_[ring_ + *head * kEventWords] = event.value;
+    mem_[ring_ + *head * kEventWords + 1] = event.info;
+    *head = (*head + 1) % size_;
+    backlog_.pop_front();
+    moved = true;
+  }
+  return moved;
+}
+
+bool InputFifo::Deliver() {
+  if (size_ == 0) return false;
+
+  uint32_t head = mem_[head_reg_] % size_;
+  const uint32_t tail =
+      __atomic_load_n(&mem_[tail_reg_], __ATOMIC_ACQUIRE) % size_;
+  bool moved = false;
+  bool waiting = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    moved = MoveBacklog(&head, tail);
+
+    // A new batch of coalesced events goes out once the guest has read past
+    // the last one.
+    const uint32_t unread = (head + size_ - tail) % size_;
+    const bool batch_unread =
+        batch_valid_ && (batch_slot_ + size_ - tail) % size_ < unread;
+    if (backlog_.empty() && HasCoalesced() && !batch_unread) {
+      FlushCoalesced();
+      if (MoveBacklog(&head, tail)) {
+        moved = true;
+        batch_valid_ = true;
+        batch_slot_ = (head + size_ - 1) % size_;
+      }
+    }
+    waiting = HasCoalesced() || !backlog_.empty();
+    // Events pushed while the ring is full still reach guests reading the
+    // legacy input register, so they need an interrupt too.
+    if (moved || pushed_ != raised_pushed_) {
+      raised_pushed_ = pushed_;
+      raise_pending_ = true;
+    }
+  }
+  if (moved) __atomic_store_n(&mem_[head_reg_], head, __ATOMIC_RELEASE);
+
+  // Interrupts raised while the guest is in a handler are dropped, so they
+  // are repeated until the guest takes one.
+  const auto now = std::chrono::steady_clock::now();
+  if (raise_pending_ && now >= next_interrupt_) {
+    if (!interrupt_ || interrupt_()) {
+      raise_pending_ = false;
+    } else {
+      next_interrupt_ = now + kRetryPeriod;
+    }
+  }
+  return waiting || raise_pending_;
+}
+
+}  // namespace gvm
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _GVM_INPUT_FIFO_H_
+#define _GVM_INPUT_FIFO_H_
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+
+#include "sync_types.h"
+
+namespace gvm {
+
+// InputFifo delivers input events to the guest through a ring in memory. The
+// host adds events and advances the head register, the guest reads them and
+// advances the tail register. Each event is kEventWords words:
+//   0: value. See InputController for the value of each event type.
+//   1: event type in bits 28-31 and the microseconds since Start in bits
+//      0-27, wrapping around.
+//
+// Events that don't fit in the ring wait on the host, so none are lost. An
+// interrupt is raised when new events arrive, and one dropped because the
+// guest was in a handler is retried every kRetryPeriod until the guest takes
+// it. One interrupt drains many events. Guests that only read the legacy
+// input register never advance the tail, so nothing is raised again for
+// events they already got an interrupt for.
+//
+// Mouse motion and joystick axis events are coalesced: motion deltas add up
+// and only the latest value of each axis is kept until the guest has read
+// the previous batch of them. Any other event flushes them first, so events
+// stay in order.
+class InputFifo {
+ public:
+  static constexpr uint32_t kEventWords = 2;
+  static constexpr std::chrono::microseconds kRetryPeriod{1000};
+
+  explicit InputFifo(uint32_t* mem);
+
+  // ring is the address of a ring of size events.
+  void SetRegisters(uint32_t ring, uint32_t size, uint32_t head_reg,
+                    uint32_t tail_reg);
+  // interrupt returns false if the guest dropped it.
+  void SetInterrupt(std::function<bool()> interrupt) { interrupt_ = interrupt; }
+
+  // Can be called from any thread.
+  void Push(uint32_t type, uint32_t value);
+
+  // Events pushed so far, from any thread.
+  uint64_t pushed() const {
+    return __atomic_load_n(&pushed_, __ATOMIC_RELAXED);
+  }
+
+  // Delivers events until Stop is called.
+  void Start();
+  void Stop();
+
+ private:
+  struct Event {
+    uint32_t value;
+    uint32_t info;
+  };
+
+  // Moves waiting events into the ring and raises the interrupt if needed.
+  // Returns true if it has to run again after kRetryPeriod, because events
+  // wait for room in the ring or an interrupt was dropped.
+  bool Deliver();
+
+  // Moves backlog events into the ring up to tail. Returns true if any moved.
+  bool MoveBacklog(uint32_t* head, uint32_t tail);
+
+  // Appends coalesced motion and axis events to the backlog.
+  void FlushCoalesced();
+  bool HasCoalesced() const {
+    return motion_pending_ || !axes_pending_.empty();
+  }
+
+  uint32_t* mem_;
+  uint32_t ring_;
+  uint32_t size_;
+  uint32_t head_reg_;
+  uint32_t tail_reg_;
+  std::function<bool()> interrupt_;
+  std::chrono::steady_clock::time_point start_;
+  std::chrono::steady_clock::time_point next_interrupt_;
+  std::mutex mutex_;
+  std::deque<Event> backlog_;
+
+  // Coalesced events and the ring slot of the last batch written.
+  bool motion_pending_;
+  int32_t motion_dx_;
+  int32_t motion_dy_;
+  uint32_t motion_info_;
+  std::map<uint32_t, Event> axes_pending_;  // Keyed by joystick and axis.
+  std::map<uint32_t, uint32_t> axes_last_;
+  bool batch_valid_;
+  uint32_t batch_slot_;
+  uint64_t pushed_;
+  uint64_t raised_pushed_;  // pushed_ when the last interrupt was raised.
+  bool raise_pending_;      // New events the guest has no interrupt for.
+  Doorbell signal_;
+  volatile bool shutdown_;
+};
+
+}  // namespace gvm
+
+#endif  // _GVM_INPUT_FIFO_H_
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "instrumentation.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "isa.h"
+
+namespace gvm {
+
+bool NoInstrumentation::Start(const std::string& path,
+                              const SymbolMap* symbols) {
+  std::cerr << "Opcode stats, traces, call graphs and coverage need a build "
+            << "with opstats=1, dstep=1, callgraph=1 or coverage=1. Not "
+            << "writing " << path << "\n";
+  return false;
+}
+
+constexpr char NoInstrumentation::kOutputOption[];
+constexpr uint32_t OpcodeStats::kOpcodes;
+constexpr char OpcodeStats::kOutputOption[];
+
+OpcodeStats::OpcodeStats() : prev_(ISA::NOP) {
+  std::memset(ops_, 0, sizeof(ops_));
+  std::memset(pairs_, 0, sizeof(pairs_));
+  std::memset(branches_, 0, sizeof(branches_));
+}
+
+bool OpcodeStats::Start(const std::string& path,
+                        const SymbolMap* symbols) {
+  path_ = path;
+  return true;
+}
+
+void OpcodeStats::Stop(const uint32_t* regs) {
+  if (!path_.empty()) WriteCsv(path_);
+}
+
+bool OpcodeStats::WriteCsv(const std::string& path) const {
+  std::ofstream out(path);
+  if (!out) {
+    std::cerr << "Unable to write opcode stats to " << path << "\n";
+    return false;
+  }
+
+  out << "kind,opcode,arg,count\n";
+  for (uint32_t op = 0; op < kOpcodes; ++op) {
+    if (ops_[op] != 0) {
+      out << "op," << OpcodeName(op) << ",," << ops_[op] << "\n";
+    }
+  }
+  for (uint32_t op = 0; op < kOpcodes; ++op) {
+    for (uint32_t next = 0; next < kOpcodes; ++next) {
+      if (pairs_[op][next] != 0) {
+        out << "pair," << OpcodeName(op) << "," << OpcodeName(next) << ","
+            << pairs_[op][next] << "\n";
+      }
+    }
+  }
+  for (uint32_t op = 0; op < kOpcodes; ++op) {
+    if (branches_[op][1] != 0) {
+      out << "branch," << OpcodeName(op) << ",taken," << branches_[op][1]
+          << "\n";
+    }
+    if (branches_[op][0] != 0) {
+      out << "branch," << OpcodeName(op) << ",not_taken,"
+          << branches_[op][0] << "\n";
+    }
+  }
+  return static_cast<bool>(out);
+}
+
+}  // namespace gvm
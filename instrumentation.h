@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _GVM_INSTRUMENTATION_H_
+#define _GVM_INSTRUMENTATION_H_
+
+#include <cstdint>
+#include <string>
+
+#include "call_graph.h"
+#include "coverage.h"
+#include "symbol_map.h"
+#include "trace.h"
+
+namespace gvm {
+
+// Instrumentation policies for Core. The core calls Op with the pc, word and
+// registers before every instruction it runs, Branch for every conditional
+// jump, Load and Store for every memory access, Call for calls and
+// interrupts, Ret for returns and Block with the pc every jump, call, return
+// and interrupt continues at. Start is called with the output path and
+// the symbols, if any, before the core runs and Stop with the final
+// registers after.
+// NoInstrumentation compiles away, so only builds that ask for a policy pay
+// for it.
+struct NoInstrumentation {
+  // Each policy names the main option for its output file.
+  static constexpr char kOutputOption[] = "";
+
+  void Op(uint32_t pc, uint32_t word, const uint32_t* regs) {}
+  void Branch(uint32_t opcode, bool taken) {}
+  void Load(uint32_t addr, uint32_t value) {}
+  void Store(uint32_t addr, uint32_t value) {}
+  void Call(uint32_t site) {}
+  void Ret() {}
+  void Block(uint32_t pc) {}
+
+  // Nothing is recorded, so this only reports that and returns false.
+  bool Start(const std::string& path, const SymbolMap* symbols);
+  void Stop(const uint32_t* regs) {}
+};
+
+// OpcodeStats counts opcodes, pairs of consecutive opcodes and the taken and
+// not taken outcomes of conditional jumps into flat arrays.
+class OpcodeStats {
+ public:
+  static constexpr uint32_t kOpcodes = 64;
+  static constexpr char kOutputOption[] = "opstats_out";
+
+  OpcodeStats();
+
+  void Op(uint32_t pc, uint32_t word, const uint32_t* regs) {
+    const uint32_t opcode = word & 0x3F;
+    ++ops_[opcode];
+    ++pairs_[prev_][opcode];
+    prev_ = opcode;
+  }
+  void Branch(uint32_t opcode, bool taken) {
+    ++branches_[opcode][taken ? 1 : 0];
+  }
+  void Load(uint32_t addr, uint32_t value) {}
+  void Store(uint32_t addr, uint32_t value) {}
+  void Call(uint32_t site) {}
+  void Ret() {}
+  void Block(uint32_t pc) {}
+
+  // Remembers path, Stop writes the counters there.
+  bool Start(const std::string& path, const SymbolMap* symbols);
+  void Stop(const uint32_t* regs);
+
+  // Writes "kind,opcode,arg,count" rows for every non zero counter:
+  //   op,<opcode>,,<count>
+  //   pair,<opcode>,<next opcode>,<count>
+  //   branch,<opcode>,taken|not_taken,<count>
+  bool WriteCsv(const std::string& path) const;
+
+ private:
+  uint64_t ops_[kOpcodes];
+  uint64_t pairs_[kOpcodes][kOpcodes];
+  uint64_t branches_[kOpcodes][2];
+  uint32_t prev_;
+  std::string path_;
+};
+
+// Policy used by the core the computer runs. Build with opstats=1 to count,
+// dstep=1 to trace, callgraph=1 to follow calls or coverage=1 to collect
+// coverage.
+#if defined(GVM_OPSTATS) + defined(GVM_TRACE) + defined(GVM_CALLGRAPH) + \
+    defined(GVM_COVERAGE) > 1
+#error "opstats, dstep, callgraph and coverage builds are exclusive"
+#elif defined(GVM_OPSTATS)
+typedef OpcodeStats CoreInstrumentation;
+#elif defined(GVM_TRACE)
+typedef Tracer CoreInstrumentation;
+#elif defined(GVM_CALLGRAPH)
+typedef CallGraph CoreInstrumentation;
+#elif defined(GVM_COVERAGE)
+typedef Coverage CoreInstrumentation;
+#else
+typedef NoInstrumentation CoreInstrumentation;
+#endif
+
+}  // namespace gvm
+
+#endif  // _GVM_INSTRUMENTATION_H_
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "interrupt_stats.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace gvm {
+
+namespace {
+
+uint64_t Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t Source(uint32_t bit) {
+  return __builtin_ctz(bit);
+}
+
+}  // namespace
+
+constexpr uint32_t InterruptStats::kSources;
+constexpr uint32_t InterruptStats::kMaxDepth;
+
+InterruptStats::InterruptStats() : depth_(0) {
+  std::memset(raised_, 0, sizeof(raised_));
+  std::memset(taken_, 0, sizeof(taken_));
+}
+
+void InterruptStats::Raise(uint32_t bit) {
+  // A bit raised again before the core took it keeps the first time.
+  uint64_t expected = 0;
+  __atomic_compare_exchange_n(&raised_[Source(bit)], &expected, Now(),
+                              false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+}
+
+void InterruptStats::Dispatch(uint32_t bit, uint32_t fp) {
+  const uint32_t source = Source(bit);
+  const uint64_t now = Now();
+  __atomic_store_n(&taken_[source], taken_[source] + 1, __ATOMIC_RELAXED);
+  const uint64_t raised =
+      __atomic_exchange_n(&raised_[source], 0, __ATOMIC_ACQUIRE);
+  // Replays raise interrupts without a device, so there is no latency.
+  if (raised != 0 && raised <= now) latency_[source].Add(now - raised);
+  if (depth_ < kMaxDepth) handlers_[depth_] = {source, fp, now};
+  ++depth_;
+}
+
+void InterruptStats::Reset() {
+  depth_ = 0;
+  // Bits raised before the reset were discarded with it.
+  for (uint32_t source = 0; source < kSources; ++source) {
+    __atomic_store_n(&raised_[source], 0, __ATOMIC_RELAXED);
+  }
+}
+
+void InterruptStats::Return() {
+  --depth_;
+  if (depth_ >= kMaxDepth) return;
+  const Handler& handler = handlers_[depth_];
+  duration_[handler.source].Add(Now() - handler.start);
+}
+
+const char* InterruptStats::SourceName(uint32_t source) {
+  static const char* kNames[kSources] = {
+    "reset", "timer", "input", "recurring timer", "timer2",
+    "recurring timer2", "video",
+  };
+  return source < kSources ? kNames[source] : "unknown";
+}
+
+void InterruptStats::PrintStats(std::ostream& out) const {
+  for (uint32_t source = 1; source < kSources; ++source) {
+    const Histogram& latency = latency_[source];
+    const Histogram& duration = duration_[source];
+    if (latency.count() == 0 && duration.count() == 0) continue;
+    out << "Interrupt " << SourceName(source) << ": " << duration.count()
+        << " handled, latency p50 " << (latency.Percentile(50) / 1000.0)
+        << "us, p99 " << (latency.Percentile(99) / 1000.0)
+        << "us, p999 " << (latency.Percentile(99.9) / 1000.0)
+        << "us; handler p50 " << (duration.Percentile(50) / 1000.0)
+        << "us, p99 " << (duration.Percentile(99) / 1000.0)
+        << "us, p999 " << (duration.Percentile(99.9) / 1000.0) << "us\n";
+  }
+}
+
+}  // namespace gvm
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _GVM_INTERRUPT_STATS_H_
+#define _GVM_INTERRUPT_STATS_H_
+
+#include <cstdint>
+#include <ostream>
+
+#include "histogram.h"
+
+namespace gvm {
+
+// InterruptStats keeps histograms, per interrupt source, of the latency from
+// a device raising the interrupt to the core dispatching its handler and of
+// how long the handler runs until the ret that leaves it. Times are host
+// nanoseconds.
+class InterruptStats {
+ public:
+  // Sources are the interrupt bits 0x02 to 0x40, indexed by bit position.
+  static constexpr uint32_t kSources = 7;
+
+  InterruptStats();
+
+  // Called by the thread raising bit, before it is set.
+  void Raise(uint32_t bit);
+  // Called by the core when it starts the handler for bit with frame fp.
+  void Dispatch(uint32_t bit, uint32_t fp);
+  // Called by the core on every ret, with the frame being left.
+  void Ret(uint32_t fp) {
+    if (depth_ != 0 && fp == handlers_[depth_ - 1].fp) Return();
+  }
+  // Forgets the handlers running and the interrupts raised, e.g. on reset.
+  void Reset();
+
+  // Only call once the core stopped. The histograms can be read while
+  // running, but percentiles may be slightly off.
+  void PrintStats(std::ostream& out) const;
+
+  static const char* SourceName(uint32_t source);
+  // Handlers dispatched, safe to read while running.
+  uint64_t taken(uint32_t source) const {
+    return __atomic_load_n(&taken_[source], __ATOMIC_RELAXED);
+  }
+  const Histogram& latency(uint32_t source) const { return latency_[source]; }
+  const Histogram& duration(uint32_t source) const {
+    return duration_[source];
+  }
+
+ private:
+  static constexpr uint32_t kMaxDepth = 8;
+
+  struct Handler {
+    uint32_t source;
+    uint32_t fp;
+    uint64_t start;
+  };
+
+  void Return();
+
+  uint64_t raised_[kSources];
+  uint64_t taken_[kSources];
+  Handler handlers_[kMaxDepth];
+  uint32_t depth_;
+  Histogram latency_[kSources];
+  Histogram duration_[kSources];
+};
+
+}  // namespace gvm
+
+#endif  // _GVM_INTERRUPT_STATS_H_
@@ -16,14 +16,266 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include "isa.h"
 
 #include <cassert>
 #include <iostream>
-
-#include "cpu.h"
+#include <sstream>
 
 namespace gvm {
 
+namespace {
+constexpr uint32_t reg1(const uint32_t word) {
+  return (word >> 6) & 0x1F;
+}
+constexpr uint32_t reg2(const uint32_t word) {
+  return (word >> 11) & 0x1F;
+}
+constexpr uint32_t reg3(const uint32_t word) {
+  return (word >> 16) & 0x1F;
+}
+constexpr uint32_t v16bit(const uint32_t word) {
+  return word >> 16;
+}
+constexpr uint32_t ext16bit(uint32_t word) {
+  word = v16bit(word);
+  return (0x00008000 & word) ? (0xFFFF0000 | word) : word;
+}
+constexpr uint32_t ext11bit(uint32_t word) {
+  word = word >> 21;
+  return (0x00000400 & word) ? (0xFFFFF800 | word) : word;
+}
+constexpr uint32_t reladdr26(const uint32_t v26bit) {
+  return (0x01000000 & v26bit) ? -(~(0xFC000000 | v26bit) + 1)
+                               : v26bit;
+}
+constexpr uint32_t reladdr21(const uint32_t v) {
+  const uint32_t v21bit = v >> 11;
+  return (0x00100000 & v21bit) ? -(~(0xFFE00000 | v21bit) + 1)
+                               : v21bit;
+}
+}  // namespace
+
+std::string PrintInstruction(const uint32_t pc, const Word word) {
+  std::ostringstream ss;
+  const auto opcode = word & 0x3F;
+
+  switch (opcode) {  // first 8 bits define the instruction.
+    case ISA::HALT:
+      ss << "halt";
+      break;
+
+    case ISA::NOP:
+      ss << "nop";
+      break;
+
+    case ISA::LOAD_RI:
+      ss << "load r" << reg1(word) << ", [0x" << std::hex << ((word >> 11) & 0x1FFFFF) << "]";
+      break;
+
+    case ISA::LOAD_IX:
+      ss << "load r" << reg1(word) << ", [r" << reg2(word) << ", 0x" << std::hex << v16bit(word) << "]";
+      break;
+
+    case ISA::LOAD_PC:
+      ss << "load r" << reg1(word) << ", [0x" << std::hex << (pc + reladdr21(word)) << "]";
+      break;
+
+    case ISA::LOAD_IXR:
+      ss << "load r" << reg1(word) << ", [r" << reg2(word) << ", r" << reg3(word) << "]";
+      break;
+
+    case ISA::LOAD_IP:
+      ss << "load post inc r" << reg1(word) << ", [r" << reg2(word) << ", 0x" << std::hex << v16bit(word) << "]";
+      break;
+
+    case ISA::LOAD_PI:
+      ss << "load pre inc r" << reg1(word) << ", [r" << reg2(word) << ", 0x" << std::hex << v16bit(word) << "]";
+      break;
+
+    case ISA::LDP_PI:
+      ss << "load pre inc r" << reg1(word) << ", r" << reg2(word) << ", [r" << reg3(word) << ", 0x" << std::hex << ext11bit(word) << "]";
+      break;
+
+    case ISA::LDP_IP:
+      ss << "load post inc r" << reg1(word) << ", r" << reg2(word) << ", [r" << reg3(word) << ", 0x" << std::hex << ext11bit(word) << "]";
+      break;
+
+    case ISA::STOR_RI:
+      ss << "stor [0x" << std::hex << ((word >> 11) & 0x1FFFFF) << "], r" << std::dec << reg1(word);
+      break;
+
+    case ISA::STOR_IX:
+      ss << "stor [r" << reg1(word) << ", 0x" << std::hex << v16bit(word) << "], r" << std::dec << reg2(word);
+      break;
+
+    case ISA::STOR_PC:
+      ss << "stor [0x" << std::hex << (pc + reladdr21(word)) << "], r" << std::dec << reg1(word);
+      break;
+
+    case ISA::STOR_IP:
+      ss << "stor post inc [r" << reg1(word) << ", 0x" << std::hex << ext16bit(word) << "], r" << std::dec << reg2(word);
+      break;
+
+    case ISA::STOR_PI:
+      ss << "stor pre inc [r" << reg1(word) << ", 0x" << std::hex << ext16bit(word) << "], r" << std::dec << reg2(word);
+      break;
+
+    case ISA::STP_PI:
+      ss << "stor pre inc [r" << reg1(word) << ", 0x" << std::hex << ext11bit(word) << "], r" << std::dec << reg2(word) << ", r" << reg3(word);
+      break;
+
+    case ISA::STP_IP:
+      ss << "stor post inc [r" << reg1(word) << ", 0x" << std::hex << ext11bit(word) << "], r" << std::dec << reg2(word) << ", r" << reg3(word);
+      break;
+
+    case ISA::ADD_RR:
+      ss << "add r" << reg1(word) << ", r" << reg2(word) << ", r" << reg3(word);
+      break;
+
+    case ISA::ADD_RI:
+      ss << "add r" << reg1(word) << ", r" << reg2(word) << ", 0x" << std::hex << v16bit(word);
+      break;
+
+    case ISA::SUB_RR:
+      ss << "sub r" << reg1(word) << ", r" << reg2(word) << ", r" << reg3(word);
+      break;
+
+    case ISA::SUB_RI:
+      ss << "sub r" << reg1(word) << ", r" << reg2(word) << ", 0x" << std::hex << v16bit(word);
+      break;
+
+    case ISA::JMP:
+      ss << "jmp 0x" << std::hex << (pc + reladdr26(word >> 6));
+      break;
+
+    case ISA::JNE:
+      ss << "jne r" << reg1(word) << ", 0x" << std::hex << (pc + reladdr21(word));
+      break;
+
+    case ISA::JEQ:
+      ss << "jeq r" << reg1(word) << ", 0x" << std::hex << (pc + reladdr21(word));
+      break;
+    case ISA::JGT:
+      ss << "jgt r" << reg1(word) << ", 0x" << std::hex << (pc + reladdr21(word));
+      break;
+
+    case ISA::JGE:
+      ss << "jge r" << reg1(word) << ", 0x" << std::hex << (pc + reladdr21(word));
+      break;
+
+    case ISA::JLT:
+      ss << "jlt r" << reg1(word) << ", 0x" << std::hex << (pc + reladdr21(word));
+      break;
+
+    case ISA::JLE:
+      ss << "jle r" << reg1(word) << ", 0x" << std::hex << (pc + reladdr21(word));
+      break;
+
+    case ISA::CALLI:
+      ss << "call 0x" << std::hex << (pc + reladdr26(word >> 6));
+      break;
+
+    case ISA::CALLR:
+      ss << "call [r" << reg1(word) << "]";
+      break;
+
+    case ISA::RET:
+      ss << "ret";
+      break;
+
+    case ISA::AND_RR:
+      ss << "and r" << reg1(word) << ", r" << reg2(word) << ", r" << reg3(word);
+      break;
+
+    case ISA::AND_RI:
+      ss << "and r" << reg1(word) << ", r" << reg2(word) << ", 0x" << std::hex << v16bit(word);
+      break;
+
+    case ISA::ORR_RR:
+      ss << "orr r" << reg1(word) << ", r" << reg2(word) << ", r" << reg3(word);
+      break;
+
+    case ISA::ORR_RI:
+      ss << "orr r" << reg1(word) << ", r" << reg2(word) << ", 0x" << std::hex << v16bit(word);
+      break;
+
+    case ISA::XOR_RR:
+      ss << "xor r" << reg1(word) << ", r" << reg2(word) << ", r" << reg3(word);
+      break;
+
+    case ISA::XOR_RI:
+      ss << "xor r" << reg1(word) << ", r" << reg2(word) << ", 0x" << std::hex << v16bit(word);
+      break;
+
+    case ISA::LSL_RR:
+      ss << "lsl r" << reg1(word) << ", r" << reg2(word) << ", r" << reg3(word);
+      break;
+
+    case ISA::LSL_RI:
+      ss << "lsl r" << reg1(word) << ", r" << reg2(word) << ", 0x" << std::hex << v16bit(word);
+      break;
+
+    case ISA::LSR_RR:
+      ss << "lsr r" << reg1(word) << ", r" << reg2(word) << ", r" << reg3(word);
+      break;
+
+    case ISA::LSR_RI:
+      ss << "lsr r" << reg1(word) << ", r" << reg2(word) << ", 0x" << std::hex << v16bit(word);
+      break;
+
+    case ISA::ASR_RR:
+      ss << "asr r" << reg1(word) << ", r" << reg2(word) << ", r" << reg3(word);
+      break;
+
+    case ISA::ASR_RI:
+      ss << "asr r" << reg1(word) << ", r" << reg2(word) << ", 0x" << std::hex << v16bit(word);
+      break;
+
+    case ISA::DIV_RI:
+      ss << "div r" << reg1(word) << ", r" << reg2(word) << ", 0x" << std::hex << v16bit(word);
+      break;
+
+    case ISA::DIV_RR:
+      ss << "div r" << reg1(word) << ", r" << reg2(word) << ", r" << reg3(word);
+      break;
+
+    case ISA::MUL_RI:
+      ss << "mul r" << reg1(word) << ", r" << reg2(word) << ", 0x" << std::hex << v16bit(word);
+      break;
+
+    case ISA::MUL_RR:
+      ss << "mul r" << reg1(word) << ", r" << reg2(word) << ", r" << reg3(word);
+      break;
+
+    case ISA::MULL_RR:
+      ss << "mull r" << reg1(word) << ", r" << reg2(word) << ", r" << reg3(word);
+      break;
+
+    case ISA::WFI:
+      ss << "wfi";
+      break;
+    default:
+      ss << "unknown 0x" << std::hex << word;
+      break;
+  }
+  return ss.str();
+}
+
+const char* OpcodeName(uint32_t opcode) {
+  static const char* names[] = {
+    "NOP", "HALT", "LOAD_RI", "LOAD_IX", "LOAD_PC", "LOAD_IXR", "LOAD_PI",
+    "LOAD_IP", "LDP_PI", "LDP_IP", "STOR_RI", "STOR_IX", "STOR_PC", "STOR_PI",
+    "STOR_IP", "STP_PI", "STP_IP", "ADD_RR", "ADD_RI", "SUB_RR", "SUB_RI",
+    "JMP", "JNE", "JEQ", "JGT", "JGE", "JLT", "JLE", "CALLI", "CALLR", "RET",
+    "AND_RR", "AND_RI", "ORR_RR", "ORR_RI", "XOR_RR", "XOR_RI", "LSL_RR",
+    "LSL_RI", "LSR_RR", "LSR_RI", "ASR_RR", "ASR_RI", "MUL_RR", "MUL_RI",
+    "DIV_RR", "DIV_RI", "MULL_RR", "WFI"
+  };
+  if (opcode > ISA::WFI) return "UNKNOWN";
+  return names[opcode];
+}
+
 Word Nop() {
   return Word(ISA::NOP);
 }
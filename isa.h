@@ -20,6 +20,7 @@
 #define _GVM_ISA_H_
 
 #include <cstdint>
+#include <string>
 
 namespace gvm {
 
@@ -80,6 +81,13 @@ enum ISA {
 
 typedef uint32_t Word;
 
+// Disassembles the instruction word found at pc. Jump and call targets are
+// printed as absolute addresses.
+std::string PrintInstruction(uint32_t pc, Word word);
+
+// Name of the ISA entry for opcode, "UNKNOWN" if there is none.
+const char* OpcodeName(uint32_t opcode);
+
 Word Nop();
 Word Halt();
 Word MovRR(uint32_t dest, uint32_t src);
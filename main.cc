@@ -17,23 +17,58 @@
 */
 
 #include <cassert>
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <memory>
 
+#include "capture_video_display.h"
 #include "computer.h"
 #include "core.h"
-#include "cpu.h"
 #include "cxxopts.hpp"
 #include "disk.h"
 #include "disk_controller.h"
+#include "event_log.h"
 #include "gfs.h"
 #include "isa.h"
 #include "memory_bus.h"
+#include "null_input_controller.h"
 #include "null_video_display.h"
+#include "profiler.h"
+#include "script_input_controller.h"
+#ifndef GVM_HEADLESS
+#include "sdl2_input_controller.h"
 #include "sdl2_video_display.h"
+#endif
+#include "shm_video_display.h"
+#include "symbol_map.h"
 
-gvm::VideoDisplay* CreateSDL2Display(const std::string& mode) {
+// Modes that run without a window.
+bool IsHeadlessMode(const std::string& mode) {
+  return mode == "null" || mode == "capture" || mode == "shm";
+}
+
+#ifdef GVM_HEADLESS
+constexpr char kVideoModes[] = "null, capture and shm";
+constexpr char kDefaultVideoMode[] = "null";
+
+gvm::VideoDisplay* CreateDisplay(const std::string& mode) {
+  if (!IsHeadlessMode(mode)) {
+    std::cerr << "Headless build only supports the " << kVideoModes
+              << " video modes. Using null.\n";
+  }
+  return new gvm::NullVideoDisplay();
+}
+
+gvm::InputController* CreateInput(const std::string& mode) {
+  return new gvm::NullInputController();
+}
+#else
+constexpr char kVideoModes[] =
+    "null, capture, shm, fullscreen, 480p, 540p, 900p and 1080p";
+constexpr char kDefaultVideoMode[] = "900p";
+
+gvm::VideoDisplay* CreateDisplay(const std::string& mode) {
   if (mode == "450p") {
     return new gvm::SDL2VideoDisplay(800, 450);
   } else if (mode == "480p") {
@@ -56,6 +91,14 @@ gvm::VideoDisplay* CreateSDL2Display(const std::string& mode) {
   return new gvm::SDL2VideoDisplay(1280, 720);
 }
 
+gvm::InputController* CreateInput(const std::string& mode) {
+  if (IsHeadlessMode(mode)) {
+    return new gvm::NullInputController();
+  }
+  return new gvm::SDL2InputController();
+}
+#endif
+
 const gvm::Rom* ReadRom(const std::string& prgrom) {
   std::ifstream in(prgrom, std::ifstream::binary | std::ifstream::in);
   return gvm::Rom::FromFile(in);
@@ -66,11 +109,80 @@ int main(int argc, char* argv[]) {
   options.add_options()
     ("prgrom", "Rom file used to boot computer. If present, will ignore chrom.",
                cxxopts::value<std::string>()->default_value(""))
-    ("video_mode", "Video mode used. Values can be: null, fullscreen, 480p, "
-                   "540p, 900p and 1080p",
-                   cxxopts::value<std::string>()->default_value("900p"))
+    ("video_mode", std::string("Video mode used. Values can be: ") +
+                   kVideoModes,
+                   cxxopts::value<std::string>()->default_value(
+                       kDefaultVideoMode))
     ("disk_file", "File to be used as 1 GiB disk. If non-existent, will try to create.",
                   cxxopts::value<std::string>()->default_value(""))
+    ("capture_dir", "Directory where the capture video mode writes frame "
+                    "hashes and dumps.",
+                    cxxopts::value<std::string>()->default_value(""))
+    ("capture_every", "With the capture video mode, dump every Nth frame to "
+                      "capture_dir as a PPM file. 0 disables dumps.",
+                      cxxopts::value<uint32_t>()->default_value("0"))
+    ("shm_name", "Shared memory object the shm video mode publishes frames "
+                 "to.",
+                 cxxopts::value<std::string>()->default_value("/gvm"))
+    ("vblank_hz", "Vblank interrupts raised per second with the null, "
+                  "capture and shm video modes, whether or not the guest "
+                  "presents frames. With 0, and always with the SDL modes, "
+                  "a vblank interrupt is raised after each presented frame "
+                  "instead.",
+                  cxxopts::value<uint32_t>()->default_value("0"))
+    ("target_fps", "Maximum frames presented per second. Doorbells rung "
+                   "before the next frame is due are merged into it. 0 "
+                   "presents every doorbell.",
+                   cxxopts::value<uint32_t>()->default_value("0"))
+    ("print_fps", "Print frames presented per second while running.",
+                  cxxopts::value<bool>()->default_value("false"))
+    ("input_replay", "Input script replayed instead of reading live input.",
+                     cxxopts::value<std::string>()->default_value(""))
+    ("input_record", "File where input events are recorded as an input "
+                     "script.",
+                     cxxopts::value<std::string>()->default_value(""))
+    ("events_record", "File where the interrupts taken and the device "
+                      "register values read are recorded for replay.",
+                      cxxopts::value<std::string>()->default_value(""))
+    ("events_replay", "Event log replayed instead of running the timer, "
+                      "blitter and input devices. The run ends in the same "
+                      "state as the recorded one.",
+                      cxxopts::value<std::string>()->default_value(""))
+    ("profile_out", "File where sampled guest call stacks are written in "
+                    "collapsed stack format. Empty disables profiling.",
+                    cxxopts::value<std::string>()->default_value(""))
+    ("profile_hz", "Profiler sampling frequency.",
+                   cxxopts::value<uint32_t>()->default_value("1000"))
+    ("opstats_out", "File where opcode, opcode pair and branch counts are "
+                    "written as CSV. Needs a build with opstats=1.",
+                    cxxopts::value<std::string>()->default_value(""))
+    ("trace_out", "File where every instruction run is recorded for "
+                  "gvm-trace. Needs a build with dstep=1.",
+                  cxxopts::value<std::string>()->default_value(""))
+    ("callgraph_out", "File where instruction counts per function and call "
+                      "site are written in callgrind format. Needs a build "
+                      "with callgraph=1.",
+                      cxxopts::value<std::string>()->default_value(""))
+    ("coverage_out", "File where the basic blocks run are written for "
+                     "gvm-coverage. Needs a build with coverage=1.",
+                     cxxopts::value<std::string>()->default_value(""))
+    ("stats_json", "File where counters and gauges from the core and "
+                   "devices are written as JSON at the end of the run.",
+                   cxxopts::value<std::string>()->default_value(""))
+    ("stats_prometheus", "File rewritten with a Prometheus text snapshot "
+                         "of the stats every stats_period_ms, or "
+                         "unix:<path> to serve one to every client of a "
+                         "unix domain socket.",
+                         cxxopts::value<std::string>()->default_value(""))
+    ("stats_period_ms", "Period between stats_prometheus file snapshots.",
+                        cxxopts::value<uint32_t>()->default_value("5000"))
+    ("cpu_affinity", "Cpu the core thread is pinned to. Negative leaves it "
+                     "to the scheduler.",
+                     cxxopts::value<int>()->default_value("-1"))
+    ("symbols", "Symbol map written by gsm -s, used to name addresses in "
+                "profiles and register dumps. Defaults to the rom file with "
+                "a .sym extension, if present.",
+                cxxopts::value<std::string>()->default_value(""))
     ;
   auto result = options.parse(argc, argv);
 
@@ -105,13 +217,88 @@ int main(int argc, char* argv[]) {
 
   auto* disk_controller = new gvm::DiskController({disk.get()});
   const std::string mode = result["video_mode"].as<std::string>();
-  const bool print_fps = mode != "null";
-  auto* display = CreateSDL2Display(mode);
+  const bool print_fps = result["print_fps"].as<bool>();
+  gvm::VideoDisplay* display = nullptr;
+  if (mode == "capture") {
+    display = new gvm::CaptureVideoDisplay(
+        result["capture_dir"].as<std::string>(),
+        result["capture_every"].as<uint32_t>());
+  } else if (mode == "shm") {
+    display = new gvm::ShmVideoDisplay(result["shm_name"].as<std::string>());
+  } else {
+    display = CreateDisplay(mode);
+  }
   auto* video_controller = new gvm::VideoController(print_fps, display);
-  auto* cpu = new gvm::CPU();
-  auto* core = new gvm::Core<gvm::MemoryBus>();
-  gvm::Computer computer(cpu, core, video_controller, disk_controller);
+  video_controller->SetTargetFps(result["target_fps"].as<uint32_t>());
+  if (!display->HasWindow()) {
+    video_controller->SetVblankFrequency(result["vblank_hz"].as<uint32_t>());
+  }
+  auto* core = new gvm::ComputerCore();
+  gvm::InputController* input = nullptr;
+  const std::string input_replay = result["input_replay"].as<std::string>();
+  if (!input_replay.empty()) {
+    auto* script = new gvm::ScriptInputController(input_replay);
+    if (!script->Load()) {
+      return -1;
+    }
+    input = script;
+  } else {
+    input = CreateInput(mode);
+  }
+  const std::string input_record = result["input_record"].as<std::string>();
+  if (!input_record.empty()) {
+    input = new gvm::RecordingInputController(input, input_record);
+  }
+  gvm::Computer computer(core, video_controller, input, disk_controller);
   const std::string prgrom = result["prgrom"].as<std::string>();
+  std::string symbols = result["symbols"].as<std::string>();
+  if (symbols.empty()) {
+    const size_t dot = prgrom.rfind('.');
+    const size_t slash = prgrom.rfind('/');
+    const bool has_ext =
+        dot != std::string::npos && (slash == std::string::npos || dot > slash);
+    symbols = (has_ext ? prgrom.substr(0, dot) : prgrom) + ".sym";
+    if (!std::ifstream(symbols)) symbols.clear();
+  }
+  if (!symbols.empty()) {
+    computer.SetSymbols(new gvm::SymbolMap(symbols));
+  }
+  const std::string profile_out = result["profile_out"].as<std::string>();
+  if (!profile_out.empty()) {
+    computer.SetProfiler(new gvm::Profiler(
+        result["profile_hz"].as<uint32_t>(), profile_out));
+  }
+  // Builds have a single instrumentation policy, which only writes to its
+  // own option.
+  for (const char* out :
+       {"opstats_out", "trace_out", "callgraph_out", "coverage_out"}) {
+    const std::string path = result[out].as<std::string>();
+    if (path.empty()) continue;
+    if (out != std::string(gvm::CoreInstrumentation::kOutputOption)) {
+      std::cerr << "--" << out << " needs a different build. See --help.\n";
+      return -1;
+    }
+    computer.SetInstrumentationPath(path);
+  }
+  const std::string events_record = result["events_record"].as<std::string>();
+  const std::string events_replay = result["events_replay"].as<std::string>();
+  if (!events_record.empty() || !events_replay.empty()) {
+    auto* events = events_replay.empty()
+        ? gvm::EventLog::Record(events_record)
+        : gvm::EventLog::Replay(events_replay);
+    if (events == nullptr) {
+      return -1;
+    }
+    computer.SetEventLog(events);
+  }
+  computer.SetCpuAffinity(result["cpu_affinity"].as<int>());
+  const std::chrono::milliseconds stats_period(
+      result["stats_period_ms"].as<uint32_t>());
+  if (!computer.SetStatsOutput(result["stats_json"].as<std::string>(),
+                               result["stats_prometheus"].as<std::string>(),
+                               stats_period)) {
+    return -1;
+  }
   const gvm::Rom* rom = nullptr;
   rom = ReadRom(prgrom);
   computer.LoadRom(rom);
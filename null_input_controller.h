@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _GVM_NULL_INPUT_CONTROLLER_H_
+#define _GVM_NULL_INPUT_CONTROLLER_H_
+
+#include "input_controller.h"
+
+namespace gvm {
+
+class NullInputController : public InputController {
+ public:
+  NullInputController() : InputController() {}
+  ~NullInputController() override {}
+
+  void Read() override {}
+};
+
+}  // namespace gvm
+
+#endif  // _GVM_NULL_INPUT_CONTROLLER_H_
@@ -30,6 +30,7 @@ class NullVideoDisplay : public VideoDisplay {
 
   void SetFramebufferSize(int fWidth, int fHeight, int bpp) override {}
   void CopyBuffer(uint32_t* mem, uint32_t mode) override {}
+  void SetTextState(uint32_t first_row, uint32_t cursor) override {}
   void SetTextRom(uint32_t* mem) override {}
   void SetColorTable(uint32_t* mem) override {}
   void Render(uint32_t mode) override {}
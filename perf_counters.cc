@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "perf_counters.h"
+
+#include <cstring>
+
+#include "isa.h"
+
+namespace gvm {
+
+PerfCounters::PerfCounters()
+    : ctrl_reg_(0), counters_reg_(0), counters_end_(0), interrupts_(0),
+      wfi_cycles_(0), frozen_(false), latched_(0) {
+  std::memset(base_, 0, sizeof(base_));
+  std::memset(frozen_values_, 0, sizeof(frozen_values_));
+}
+
+void PerfCounters::SetRegisters(uint32_t ctrl_reg, uint32_t counters_reg) {
+  ctrl_reg_ = ctrl_reg;
+  counters_reg_ = counters_reg;
+  counters_end_ = counters_reg + COUNTERS * 2 * kWordSize;
+}
+
+uint32_t PerfCounters::Read(uint32_t addr, uint64_t instructions) {
+  const uint32_t word = (addr - counters_reg_) / kWordSize;
+  if (word % 2 == 1) return latched_ >> 32;
+
+  const uint32_t counter = word / 2;
+  if (frozen_) {
+    latched_ = frozen_values_[counter];
+  } else {
+    uint64_t raw[COUNTERS];
+    Raw(instructions, raw);
+    latched_ = raw[counter] - base_[counter];
+  }
+  return latched_ & 0xFFFFFFFF;
+}
+
+void PerfCounters::Control(uint32_t value, uint64_t instructions) {
+  uint64_t raw[COUNTERS];
+  Raw(instructions, raw);
+  if (value & RESET) {
+    for (uint32_t i = 0; i < COUNTERS; ++i) {
+      base_[i] = raw[i];
+      frozen_values_[i] = 0;
+    }
+  }
+  const bool freeze = (value & FREEZE) != 0;
+  if (freeze && !frozen_) {
+    for (uint32_t i = 0; i < COUNTERS; ++i) {
+      frozen_values_[i] = raw[i] - base_[i];
+    }
+  } else if (!freeze && frozen_) {
+    for (uint32_t i = 0; i < COUNTERS; ++i) {
+      base_[i] = raw[i] - frozen_values_[i];
+    }
+  }
+  frozen_ = freeze;
+}
+
+void PerfCounters::Raw(uint64_t instructions, uint64_t* raw) const {
+  raw[INSTRUCTIONS] = instructions;
+  raw[CYCLES] = HostCycles();
+  raw[INTERRUPTS] = interrupts_;
+  raw[WFI_CYCLES] = wfi_cycles_;
+}
+
+}  // namespace gvm
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _GVM_PERF_COUNTERS_H_
+#define _GVM_PERF_COUNTERS_H_
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace gvm {
+
+// Host cycles from the time stamp counter, nanoseconds where there is none.
+inline uint64_t HostCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// PerfCounters are the performance counters guest code reads to measure
+// itself. Each counter is 64 bits wide and takes two words, low word first.
+// Reading the low word latches the counter, so the high word read next
+// matches it. The instruction counter includes the instruction reading it.
+//
+// Writing RESET to the control register zeroes the counters and FREEZE
+// stops them until a write without FREEZE.
+class PerfCounters {
+ public:
+  enum Counter {
+    INSTRUCTIONS = 0,  // Instructions retired.
+    CYCLES,            // Host cycles.
+    INTERRUPTS,        // Interrupts taken, resets and profiler samples aside.
+    WFI_CYCLES,        // Host cycles spent waiting in wfi.
+    COUNTERS,
+  };
+  // Control register bits.
+  enum Control {
+    RESET = 0x01,
+    FREEZE = 0x02,
+  };
+
+  PerfCounters();
+
+  void SetRegisters(uint32_t ctrl_reg, uint32_t counters_reg);
+  uint32_t ctrl_reg() const { return ctrl_reg_; }
+  // True if addr is one of the counter words.
+  bool Owns(uint32_t addr) const {
+    return addr >= counters_reg_ && addr < counters_end_;
+  }
+
+  // instructions is the number of instructions the core ran so far.
+  uint32_t Read(uint32_t addr, uint64_t instructions);
+  void Control(uint32_t value, uint64_t instructions);
+
+  void Interrupt() { ++interrupts_; }
+  void Wait(uint64_t cycles) { wfi_cycles_ += cycles; }
+  // Host cycles spent in wfi since power on, whatever the guest reset. Can
+  // be read from other threads.
+  uint64_t wfi_cycles() const {
+    return __atomic_load_n(&wfi_cycles_, __ATOMIC_RELAXED);
+  }
+
+ private:
+  // Fills raw with the totals since power on.
+  void Raw(uint64_t instructions, uint64_t* raw) const;
+
+  uint32_t ctrl_reg_;
+  uint32_t counters_reg_;
+  uint32_t counters_end_;
+  uint64_t interrupts_;
+  uint64_t wfi_cycles_;
+  // Counter values are raw - base_ while running and frozen_values_ while
+  // frozen.
+  uint64_t base_[COUNTERS];
+  uint64_t frozen_values_[COUNTERS];
+  bool frozen_;
+  uint64_t latched_;
+};
+
+}  // namespace gvm
+
+#endif  // _GVM_PERF_COUNTERS_H_
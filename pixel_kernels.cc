@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pixel_kernels.h"
+
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace gvm {
+
+void ExpandIndexed(const uint8_t* src, const uint32_t* palette, uint32_t* dst,
+                   size_t count) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  const int* table = reinterpret_cast<const int*>(palette);
+  for (; i + 8 <= count; i += 8) {
+    const __m128i bytes =
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&src[i]));
+    const __m256i idx = _mm256_cvtepu8_epi32(bytes);
+    const __m256i px = _mm256_i32gather_epi32(table, idx, 4);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(&dst[i]), px);
+  }
+#endif
+  for (; i < count; ++i) {
+    dst[i] = palette[src[i]];
+  }
+}
+
+void ExpandIndexedTransparent(const uint8_t* src, const uint32_t* palette,
+                              uint32_t* dst, size_t count) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  const int* table = reinterpret_cast<const int*>(palette);
+  const __m256i zero = _mm256_setzero_si256();
+  for (; i + 8 <= count; i += 8) {
+    const __m128i bytes =
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&src[i]));
+    const __m256i idx = _mm256_cvtepu8_epi32(bytes);
+    const __m256i px = _mm256_i32gather_epi32(table, idx, 4);
+    const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&dst[i]));
+    const __m256i keep = _mm256_cmpeq_epi32(idx, zero);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(&dst[i]),
+                        _mm256_blendv_epi8(px, d, keep));
+  }
+#endif
+  for (; i < count; ++i) {
+    if (src[i] != 0) dst[i] = palette[src[i]];
+  }
+}
+
+void Fill32(uint32_t* dst, uint32_t color, size_t count) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  const __m256i px = _mm256_set1_epi32(color);
+  for (; i + 8 <= count; i += 8) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(&dst[i]), px);
+  }
+#endif
+  for (; i < count; ++i) {
+    dst[i] = color;
+  }
+}
+
+void KeyedCopy32(const uint32_t* src, uint32_t key, uint32_t* dst, size_t count) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  const __m256i k = _mm256_set1_epi32(key);
+  for (; i + 8 <= count; i += 8) {
+    const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&src[i]));
+    const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&dst[i]));
+    const __m256i keep = _mm256_cmpeq_epi32(s, k);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(&dst[i]),
+                        _mm256_blendv_epi8(s, d, keep));
+  }
+#endif
+  for (; i < count; ++i) {
+    if (src[i] != key) dst[i] = src[i];
+  }
+}
+
+void KeyedCopy32Backward(const uint32_t* src, uint32_t key, uint32_t* dst,
+                         size_t count) {
+  size_t i = count;
+#if defined(__AVX2__)
+  const __m256i k = _mm256_set1_epi32(key);
+  for (; i >= 8; i -= 8) {
+    const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&src[i - 8]));
+    const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&dst[i - 8]));
+    const __m256i keep = _mm256_cmpeq_epi32(s, k);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(&dst[i - 8]),
+                        _mm256_blendv_epi8(s, d, keep));
+  }
+#endif
+  while (i > 0) {
+    --i;
+    if (src[i] != key) dst[i] = src[i];
+  }
+}
+
+void GlyphRow32(uint8_t bits, uint32_t fg, uint32_t bg, bool transparent,
+                uint32_t* dst) {
+#if defined(__AVX2__)
+  const __m256i lanes = _mm256_setr_epi32(0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+  const __m256i on = _mm256_cmpeq_epi32(
+      _mm256_and_si256(_mm256_set1_epi32(bits), lanes), lanes);
+  const __m256i back = transparent
+      ? _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst))
+      : _mm256_set1_epi32(bg);
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst),
+                      _mm256_blendv_epi8(back, _mm256_set1_epi32(fg), on));
+#else
+  for (int i = 0; i < 8; ++i) {
+    if (bits & (0x80 >> i)) {
+      dst[i] = fg;
+    } else if (!transparent) {
+      dst[i] = bg;
+    }
+  }
+#endif
+}
+
+static inline uint32_t SwapRB(uint32_t px) {
+  return (px & 0xFF00FF00) | ((px & 0xFF) << 16) | ((px >> 16) & 0xFF);
+}
+
+void ScaleRow32(const uint32_t* src, size_t count, int factor, bool swap_rb,
+                uint32_t* dst) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  // Every 8 source pixels become factor blocks of 8 output pixels. Output
+  // pixel j of block k comes from source pixel (8 * k + j) / factor.
+  if (factor >= 1 && factor <= 4) {
+    __m256i idx[4];
+    for (int k = 0; k < factor; ++k) {
+      idx[k] = _mm256_setr_epi32(
+          (8 * k) / factor, (8 * k + 1) / factor, (8 * k + 2) / factor,
+          (8 * k + 3) / factor, (8 * k + 4) / factor, (8 * k + 5) / factor,
+          (8 * k + 6) / factor, (8 * k + 7) / factor);
+    }
+    const __m256i rb = _mm256_setr_epi8(
+        2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+        2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    for (; i + 8 <= count; i += 8) {
+      __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&src[i]));
+      if (swap_rb) px = _mm256_shuffle_epi8(px, rb);
+      for (int k = 0; k < factor; ++k) {
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(&dst[i * factor + 8 * k]),
+            _mm256_permutevar8x32_epi32(px, idx[k]));
+      }
+    }
+  }
+#endif
+  for (; i < count; ++i) {
+    const uint32_t px = swap_rb ? SwapRB(src[i]) : src[i];
+    for (int k = 0; k < factor; ++k) {
+      dst[i * factor + k] = px;
+    }
+  }
+}
+
+uint64_t HashPixels(const uint32_t* src, size_t count) {
+  // Four independent lanes keep the multiplies pipelined.
+  const uint64_t kMul = 0x9E3779B97F4A7C15ULL;
+  uint64_t h[4] = {count, ~count, kMul, 0x632BE59BD9B4E019ULL};
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    for (int l = 0; l < 4; ++l) {
+      uint64_t v;
+      std::memcpy(&v, &src[i + l * 2], sizeof(v));
+      h[l] = (h[l] ^ v) * kMul;
+      h[l] ^= h[l] >> 29;
+    }
+  }
+  for (; i < count; ++i) {
+    h[0] = (h[0] ^ src[i]) * kMul;
+    h[0] ^= h[0] >> 29;
+  }
+  uint64_t hash = 0;
+  for (int l = 0; l < 4; ++l) {
+    hash = (hash ^ h[l]) * kMul;
+    hash ^= hash >> 32;
+  }
+  return hash;
+}
+
+}  // namespace gvm
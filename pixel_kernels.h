@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _GVM_PIXEL_KERNELS_H_
+#define _GVM_PIXEL_KERNELS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace gvm {
+
+// Expands count 8bpp palette indices from src into 32bpp pixels at dst using
+// the 256 entry palette.
+void ExpandIndexed(const uint8_t* src, const uint32_t* palette, uint32_t* dst,
+                   size_t count);
+
+// Same as ExpandIndexed, but index 0 is transparent and leaves dst untouched.
+void ExpandIndexedTransparent(const uint8_t* src, const uint32_t* palette,
+                              uint32_t* dst, size_t count);
+
+// Sets count pixels at dst to color.
+void Fill32(uint32_t* dst, uint32_t color, size_t count);
+
+// Copies count pixels from src to dst, skipping the ones equal to key.
+void KeyedCopy32(const uint32_t* src, uint32_t key, uint32_t* dst, size_t count);
+
+// Same as KeyedCopy32, but from the last pixel down, for a dst that starts
+// inside src.
+void KeyedCopy32Backward(const uint32_t* src, uint32_t key, uint32_t* dst,
+                         size_t count);
+
+// Draws one 8 pixel wide glyph row. Bit 7 of bits is the leftmost pixel. When
+// transparent is set, pixels for 0 bits are left untouched.
+void GlyphRow32(uint8_t bits, uint32_t fg, uint32_t bg, bool transparent,
+                uint32_t* dst);
+
+// Writes each of the count pixels at src factor times to dst, which must have
+// room for count * factor pixels. factor must be between 1 and 4. With
+// swap_rb, red and blue are exchanged, turning ABGR8888 into ARGB8888.
+void ScaleRow32(const uint32_t* src, size_t count, int factor, bool swap_rb,
+                uint32_t* dst);
+
+// Fast 64-bit hash of count pixels. Not cryptographic; meant for telling
+// frames apart.
+uint64_t HashPixels(const uint32_t* src, size_t count);
+
+}  // namespace gvm
+
+#endif  // _GVM_PIXEL_KERNELS_H_
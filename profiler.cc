@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "profiler.h"
+
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace gvm {
+
+constexpr uint32_t Profiler::kMaxDepth;
+constexpr uint32_t Profiler::kRingSize;
+
+Profiler::Profiler(uint32_t hz, const std::string& path)
+    : period_(std::chrono::nanoseconds(1000000000) / (hz == 0 ? 1 : hz)),
+      path_(path), symbols_(nullptr), ring_(kRingSize), head_(0), tail_(0),
+      samples_(0), dropped_(0), shutdown_(false) {
+}
+
+void Profiler::Start() {
+  assert(request_ != nullptr);
+  auto next = std::chrono::steady_clock::now();
+  while (!shutdown_) {
+    request_();
+    next += period_;
+    signal_.WaitUntil(next);
+    Drain();
+  }
+  Drain();
+}
+
+void Profiler::Stop() {
+  shutdown_ = true;
+  signal_.Close();
+}
+
+void Profiler::Drain() {
+  const uint32_t head = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+  while (tail_ != head) {
+    const Sample& sample = ring_[tail_ % kRingSize];
+    std::vector<uint32_t> stack(sample.pcs, sample.pcs + sample.depth);
+    ++stacks_[stack];
+    ++samples_;
+    __atomic_store_n(&tail_, tail_ + 1, __ATOMIC_RELEASE);
+  }
+}
+
+bool Profiler::Write() const {
+  std::ofstream out(path_);
+  if (!out) {
+    std::cerr << "Unable to write profile to " << path_ << "\n";
+    return false;
+  }
+
+  // Distinct pcs can share a name, so merge stacks after naming them.
+  std::map<std::string, uint64_t> named;
+  for (const auto& stack : stacks_) {
+    std::stringstream line;
+    for (auto pc = stack.first.rbegin(); pc != stack.first.rend(); ++pc) {
+      if (pc != stack.first.rbegin()) line << ";";
+      if (symbols_ != nullptr) {
+        line << symbols_->Name(*pc);
+      } else {
+        line << "0x" << std::hex << *pc;
+      }
+    }
+    named[line.str()] += stack.second;
+  }
+  for (const auto& stack : named) {
+    out << stack.first << " " << stack.second << "\n";
+  }
+  return static_cast<bool>(out);
+}
+
+}  // namespace gvm
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _GVM_PROFILER_H_
+#define _GVM_PROFILER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "symbol_map.h"
+#include "sync_types.h"
+
+namespace gvm {
+
+// Profiler samples the guest call stack at a fixed rate. Start asks the cpu
+// for a sample every period through the request function, and the cpu
+// answers from its interrupt path by writing the pc and the return
+// addresses found following the fp chain into a single producer ring. The
+// profiler thread drains the ring and counts identical stacks, which Write
+// outputs as collapsed stacks for flame graph tools.
+class Profiler {
+ public:
+  static constexpr uint32_t kMaxDepth = 64;
+  static constexpr uint32_t kRingSize = 256;
+
+  struct Sample {
+    uint32_t depth;
+    uint32_t pcs[kMaxDepth];  // pcs[0] is the sampled pc, then its callers.
+  };
+
+  Profiler(uint32_t hz, const std::string& path);
+
+  void SetSymbols(const SymbolMap* symbols) { symbols_ = symbols; }
+  void SetRequest(std::function<void()> request) { request_ = request; }
+
+  // Called by the cpu thread. Returns nullptr when the ring is full, which
+  // drops the sample. Otherwise the sample must be filled and committed.
+  Sample* Begin() {
+    const uint32_t head = head_;
+    if (head - __atomic_load_n(&tail_, __ATOMIC_ACQUIRE) == kRingSize) {
+      ++dropped_;
+      return nullptr;
+    }
+    return &ring_[head % kRingSize];
+  }
+  void Commit() { __atomic_store_n(&head_, head_ + 1, __ATOMIC_RELEASE); }
+
+  // Requests samples until Stop is called.
+  void Start();
+  void Stop();
+
+  // Writes one "root;...;leaf count" line per distinct stack, named with the
+  // symbol map if one was set. Returns false if the file can't be written.
+  bool Write() const;
+
+  uint64_t samples() const { return samples_; }
+  uint64_t dropped() const { return dropped_; }
+
+ private:
+  void Drain();
+
+  const std::chrono::nanoseconds period_;
+  const std::string path_;
+  const SymbolMap* symbols_;
+  std::function<void()> request_;
+  std::vector<Sample> ring_;
+  uint32_t head_;
+  uint32_t tail_;
+  uint64_t samples_;
+  uint64_t dropped_;
+  std::map<std::vector<uint32_t>, uint64_t> stacks_;
+  Doorbell signal_;
+  volatile bool shutdown_;
+};
+
+}  // namespace gvm
+
+#endif  // _GVM_PROFILER_H_
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "rasterizer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "pixel_kernels.h"
+#include "video_display.h"
+
+namespace gvm {
+
+constexpr int Rasterizer::kTextCols;
+constexpr int Rasterizer::kTextRows;
+constexpr int Rasterizer::kCharWidth;
+constexpr int Rasterizer::kCharHeight;
+constexpr int Rasterizer::kTextWidth;
+constexpr int Rasterizer::kTextHeight;
+
+Rasterizer::Rasterizer()
+    : text_rom_(nullptr), color_table_(nullptr), text_first_row_(0),
+      text_cursor_(0), text_dirty_rows_(0), text_full_redraw_(true),
+      text_palette_(256, 0) {
+  // The text buffer is 100x28 chars wide, with each char uisng 4 bytes (2 for
+  // char, 1 for fgcolor, 1 for bg color.
+  text_vram_buffer_ = new uint32_t[kTextCols * kTextRows];
+  text_pixels_ = new uint32_t[kTextWidth * kTextHeight];
+  memset(text_vram_buffer_, 0, sizeof(uint32_t) * kTextCols * kTextRows);
+  memset(text_pixels_, 0, sizeof(uint32_t) * kTextWidth * kTextHeight);
+}
+
+Rasterizer::~Rasterizer() {
+  delete [] text_vram_buffer_;
+  delete [] text_pixels_;
+}
+
+void Rasterizer::CopyGraphics(const uint32_t* mem, uint32_t mode, int width,
+                              int height, uint8_t* dst, int pitch) const {
+  const int row_size = width * sizeof(uint32_t);
+  if (mode == kGraphicsMode) {
+    if (pitch == row_size) {
+      std::memcpy(dst, mem, row_size * height);
+      return;
+    }
+    for (int y = 0; y < height; ++y) {
+      std::memcpy(&dst[y * pitch], &mem[y * width], row_size);
+    }
+  } else if (mode == kIndexedGraphicsMode) {
+    // The framebuffer has one byte per pixel, so we expand it through the
+    // color table. Changing the color table is enough to recolor the whole
+    // screen on the next frame.
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(mem);
+    for (int y = 0; y < height; ++y) {
+      ExpandIndexed(&src[y * width], color_table_,
+                    reinterpret_cast<uint32_t*>(&dst[y * pitch]), width);
+    }
+  }
+}
+
+void Rasterizer::UpdateText(const uint32_t* mem) {
+  // Only rows that changed since the last frame are redrawn, so scrolling
+  // through the first row register costs a single row.
+  // A palette change recolors every row.
+  if (!std::equal(text_palette_.begin(), text_palette_.end(), color_table_)) {
+    std::copy(color_table_, color_table_ + 256, text_palette_.begin());
+    text_full_redraw_ = true;
+  }
+  for (int row = 0; row < kTextRows; ++row) {
+    const uint32_t* src = &mem[row * kTextCols];
+    uint32_t* cached = &text_vram_buffer_[row * kTextCols];
+    if (!text_full_redraw_ &&
+        std::memcmp(src, cached, sizeof(uint32_t) * kTextCols) == 0) {
+      continue;
+    }
+    std::memcpy(cached, src, sizeof(uint32_t) * kTextCols);
+    text_dirty_rows_ |= 1 << row;
+  }
+  text_full_redraw_ = false;
+}
+
+void Rasterizer::SetTextState(uint32_t first_row, uint32_t cursor) {
+  first_row %= kTextRows;
+  if (first_row == text_first_row_ && cursor == text_cursor_) return;
+  MarkCursorRow();
+  text_first_row_ = first_row;
+  text_cursor_ = cursor;
+  MarkCursorRow();
+}
+
+void Rasterizer::MarkCursorRow() {
+  if ((text_cursor_ & 0x10000) == 0) return;
+  const uint32_t row =
+      (((text_cursor_ >> 8) & 0xFF) + text_first_row_) % kTextRows;
+  text_dirty_rows_ |= 1 << row;
+}
+
+void Rasterizer::DrawChar(uint32_t ch, uint32_t fg, uint32_t bg, int x,
+                          int y) {
+  // Each glyph is 16 rows of one byte, packed 4 rows per word.
+  const uint32_t* char_word = &text_rom_[ch << 2];
+  uint32_t* dst = &text_pixels_[y * kTextWidth * kCharHeight + x * kCharWidth];
+  for (int row = 0; row < kCharHeight; ++row) {
+    const uint8_t bits = (char_word[row >> 2] >> ((row & 3) * 8)) & 0xFF;
+    GlyphRow32(bits, fg, bg, false, &dst[row * kTextWidth]);
+  }
+}
+
+bool Rasterizer::DrawText(int* first_dirty, int* last_dirty) {
+  // text_pixels_ holds the rows in ring order, the same as vram.
+  const bool cursor_on = text_cursor_ & 0x10000;
+  const uint32_t cursor_x = text_cursor_ & 0xFF;
+  const uint32_t cursor_row =
+      (((text_cursor_ >> 8) & 0xFF) + text_first_row_) % kTextRows;
+  *first_dirty = -1;
+  *last_dirty = -1;
+  for (int y = 0; y < kTextRows; ++y) {
+    if ((text_dirty_rows_ & (1 << y)) == 0) continue;
+    if (*first_dirty == -1) *first_dirty = y;
+    *last_dirty = y;
+    for (int x = 0; x < kTextCols; ++x) {
+      const auto i = y * kTextCols + x;
+      const auto ch = text_vram_buffer_[i] & 0xFFFF;
+      auto fg = color_table_[(text_vram_buffer_[i] >> 16) & 0xFF];
+      auto bg = color_table_[(text_vram_buffer_[i] >> 24) & 0xFF];
+      if (cursor_on && cursor_row == static_cast<uint32_t>(y) &&
+          cursor_x == static_cast<uint32_t>(x)) {
+        std::swap(fg, bg);
+      }
+      DrawChar(ch, fg, bg, x, y);
+    }
+  }
+  text_dirty_rows_ = 0;
+  return *first_dirty != -1;
+}
+
+void Rasterizer::ResolveText(uint32_t* dst) const {
+  const int split = text_first_row_ * kCharHeight;
+  const int top = kTextRows * kCharHeight - split;
+  std::memcpy(dst, &text_pixels_[split * kTextWidth],
+              sizeof(uint32_t) * top * kTextWidth);
+  std::memcpy(&dst[top * kTextWidth], text_pixels_,
+              sizeof(uint32_t) * split * kTextWidth);
+  const int used = kTextRows * kCharHeight;
+  std::memcpy(&dst[used * kTextWidth], &text_pixels_[used * kTextWidth],
+              sizeof(uint32_t) * (kTextHeight - used) * kTextWidth);
+}
+
+}  // namespace gvm
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _GVM_RASTERIZER_H_
+#define _GVM_RASTERIZER_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace gvm {
+
+// Rasterizer turns guest frames into 32bpp pixels without touching any
+// display library, so every VideoDisplay draws the same picture.
+class Rasterizer {
+ public:
+  static constexpr int kTextCols = 100;
+  static constexpr int kTextRows = 28;
+  static constexpr int kCharWidth = 8;
+  static constexpr int kCharHeight = 16;
+  static constexpr int kTextWidth = kTextCols * kCharWidth;
+  static constexpr int kTextHeight = 450;
+
+  Rasterizer();
+  ~Rasterizer();
+
+  void SetTextRom(const uint32_t* mem) { text_rom_ = mem; }
+  void SetColorTable(const uint32_t* mem) { color_table_ = mem; }
+
+  // Converts a graphics or indexed graphics frame of width x height pixels to
+  // 32bpp, writing each row pitch bytes apart at dst.
+  void CopyGraphics(const uint32_t* mem, uint32_t mode, int width, int height,
+                    uint8_t* dst, int pitch) const;
+
+  // Caches the text mode frame at mem and marks the rows that changed.
+  void UpdateText(const uint32_t* mem);
+
+  // See VideoDisplay::SetTextState.
+  void SetTextState(uint32_t first_row, uint32_t cursor);
+
+  // Redraws the dirty rows into text_pixels. Returns false if nothing was
+  // drawn, otherwise the range of ring rows drawn.
+  bool DrawText(int* first_dirty, int* last_dirty);
+
+  // Copies the text pixels to dst in screen order, starting from the first
+  // row. dst has room for kTextWidth x kTextHeight pixels.
+  void ResolveText(uint32_t* dst) const;
+
+  // Text pixels, kTextWidth x kTextHeight, with rows in ring order.
+  const uint32_t* text_pixels() const { return text_pixels_; }
+  uint32_t text_first_row() const { return text_first_row_; }
+
+ private:
+  void MarkCursorRow();
+  void DrawChar(uint32_t ch, uint32_t fg, uint32_t bg, int x, int y);
+
+  const uint32_t* text_rom_;
+  const uint32_t* color_table_;
+  uint32_t* text_vram_buffer_;
+  uint32_t* text_pixels_;
+  uint32_t text_first_row_;
+  uint32_t text_cursor_;
+  uint32_t text_dirty_rows_;  // Bit per ring row that needs to be redrawn.
+  bool text_full_redraw_;
+  std::vector<uint32_t> text_palette_;  // Colors the rows were drawn with.
+};
+
+}  // namespace gvm
+
+#endif  // _GVM_RASTERIZER_H_
@@ -21,4 +21,9 @@
 : "${DEBUG:=0}"
 : "${CXX:=0}
 : "${M:=6}
-killall -9 gvm; cd $HOME/gvm/gsm && go install && cd .. && time gsm -o bench.rom $BENCH && scons -j$M dstep=$DEBUG handlers=$CPU clang=$CXX  && time ./gvm --prgrom=bench.rom --video_mode=null
+: "${HEADLESS:=0}"
+BIN=./gvm
+if [ "$HEADLESS" != "0" ]; then
+  BIN=./gvm-headless
+fi
+killall -9 gvm gvm-headless; cd $HOME/gvm/gsm && go install && cd .. && time gsm -o bench.rom $BENCH && scons -j$M dstep=$DEBUG handlers=$CPU clang=$CXX  && time $BIN --prgrom=bench.rom --video_mode=null
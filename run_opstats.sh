@@ -0,0 +1,72 @@
+#!/bin/bash
+
+# Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+# Author: Igor Cananea <icc@avalonbits.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Runs every benchmark in perf/ on a gvm-headless built with opstats=1 and
+# aggregates the opcode, opcode pair and branch counts of all of them into
+# $OUT/total.csv. Prints the most frequent opcodes and pairs and the taken
+# ratio of each conditional jump.
+
+: "${OUT:=opstats}"
+: "${TOP:=20}"
+: "${M:=6}"
+
+cd $HOME/gvm/gsm && go install && cd .. || exit 1
+scons -j$M opstats=1 gvm-headless || exit 1
+mkdir -p $OUT
+
+for b in $(\find ./perf -name '*.asm' -type f | sort)
+  do
+    name=$(basename $b .asm)
+    echo "Running $name"
+    gsm -o $OUT/$name.rom $b || exit 1
+    ./gvm-headless --prgrom=$OUT/$name.rom --video_mode=null \
+        --opstats_out=$OUT/$name.csv > /dev/null 2>&1
+  done
+
+awk -F, 'FNR > 1 { count[$1 "," $2 "," $3] += $4 }
+  END {
+    print "kind,opcode,arg,count"
+    for (k in count) print k "," count[k]
+  }' $(ls $OUT/*.csv | grep -v total.csv) > $OUT/total.csv
+
+echo ""
+echo "Opcodes:"
+awk -F, '$1 == "op" { total += $4; count[$2] = $4 }
+  END {
+    for (op in count) printf "%-10s %14d %6.2f%%\n", op, count[op], 100 * count[op] / total
+  }' $OUT/total.csv | sort -k2 -n -r | head -$TOP
+
+echo ""
+echo "Opcode pairs:"
+awk -F, '$1 == "pair" { total += $4; count[$2 " " $3] = $4 }
+  END {
+    for (p in count) {
+      split(p, ops, " ")
+      printf "%-10s %-10s %14d %6.2f%%\n", ops[1], ops[2], count[p], 100 * count[p] / total
+    }
+  }' $OUT/total.csv | sort -k3 -n -r | head -$TOP
+
+echo ""
+echo "Branches:"
+awk -F, '$1 == "branch" { count[$2 "," $3] = $4; ops[$2] = 1 }
+  END {
+    for (op in ops) {
+      taken = count[op ",taken"]; total = taken + count[op ",not_taken"]
+      printf "%-10s %14d %6.2f%% taken\n", op, total, 100 * taken / total
+    }
+  }' $OUT/total.csv | sort -k2 -n -r
@@ -0,0 +1,299 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "script_input_controller.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "utf8.h"
+
+namespace gvm {
+
+namespace {
+
+bool ParseNumber(const std::string& s, int64_t* value) {
+  if (s.empty()) return false;
+  char* end = nullptr;
+  *value = strtoll(s.c_str(), &end, 0);
+  return *end == '\0';
+}
+
+bool ParseState(const std::string& s, uint32_t* release) {
+  if (s == "down") {
+    *release = 0;
+    return true;
+  }
+  if (s == "up") {
+    *release = 1u << 31;
+    return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+ScriptInputController::ScriptInputController(const std::string& path)
+    : InputController(), path_(path) {}
+
+bool ScriptInputController::Load() {
+  std::ifstream in(path_);
+  if (!in) {
+    std::cerr << "Unable to read input script " << path_ << "\n";
+    return false;
+  }
+  std::string line;
+  int line_number = 0;
+  while (std::getline(in, line)) {
+    ++line_number;
+    if (!ParseLine(line, line_number)) return false;
+  }
+  return true;
+}
+
+bool ScriptInputController::ParseLine(const std::string& line,
+                                      int line_number) {
+  std::istringstream ss(line);
+  std::string cmd;
+  if (!(ss >> cmd) || cmd[0] == '#') return true;
+
+  std::vector<std::string> args;
+  std::string arg;
+  if (cmd != "text") {
+    while (ss >> arg) args.push_back(arg);
+  }
+  int64_t n[3];
+  auto numbers = [&args, &n](size_t count) {
+    if (args.size() < count) return false;
+    for (size_t i = 0; i < count; ++i) {
+      if (!ParseNumber(args[i], &n[i])) return false;
+    }
+    return true;
+  };
+  auto event = [this](uint32_t type, uint32_t value) {
+    commands_.push_back({Command::EVENT, type, value, 0});
+  };
+
+  bool ok = true;
+  uint32_t release = 0;
+  if (cmd == "wait" && args.size() == 1) {
+    const std::string& amount = args[0];
+    const size_t digits = amount.find_first_not_of("0123456789");
+    int64_t count = 0;
+    ok = digits != 0 && digits != std::string::npos &&
+         ParseNumber(amount.substr(0, digits), &count);
+    const std::string unit = ok ? amount.substr(digits) : "";
+    if (unit == "ms") {
+      commands_.push_back({Command::WAIT_TIME, 0, 0,
+                           static_cast<uint64_t>(count) * 1000});
+    } else if (unit == "us") {
+      commands_.push_back(
+          {Command::WAIT_TIME, 0, 0, static_cast<uint64_t>(count)});
+    } else if (unit == "i") {
+      commands_.push_back(
+          {Command::WAIT_INSTRUCTIONS, 0, 0, static_cast<uint64_t>(count)});
+    } else {
+      ok = false;
+    }
+  } else if (cmd == "key_down" && numbers(1)) {
+    event(kInputKeyDown, n[0]);
+  } else if (cmd == "key_up" && numbers(1)) {
+    event(kInputKeyUp, n[0] | (1u << 31));
+  } else if (cmd == "key" && numbers(1)) {
+    event(kInputKeyDown, n[0]);
+    event(kInputKeyUp, n[0] | (1u << 31));
+  } else if (cmd == "text") {
+    const size_t first = line.find('"');
+    const size_t last = line.rfind('"');
+    ok = first != std::string::npos && last > first;
+    std::string text;
+    for (size_t i = first + 1; ok && i < last; ++i) {
+      if (line[i] == '\\' && i + 1 < last) {
+        ++i;
+        text.push_back(line[i] == 'n' ? '\n' : line[i]);
+      } else {
+        text.push_back(line[i]);
+      }
+    }
+    const char* str = text.c_str();
+    while (ok && *str != '\0') {
+      utf8_int32_t codepoint = 0;
+      str = reinterpret_cast<const char*>(utf8codepoint(str, &codepoint));
+      event(kInputText, static_cast<uint32_t>(codepoint));
+    }
+  } else if (cmd == "mouse_motion" && numbers(2)) {
+    event(kInputMouseMotion,
+          (n[0] & 0xFFFF) | (static_cast<uint32_t>(n[1] & 0xFFFF) << 16));
+  } else if (cmd == "mouse_button" && numbers(1) && args.size() == 2 &&
+             ParseState(args[1], &release)) {
+    event(kInputMouseButton, (n[0] & 0xFF) | release);
+  } else if (cmd == "joy_axis" && numbers(3)) {
+    event(kInputJoyAxis, (n[2] & 0xFFFF) | ((n[1] & 0xFF) << 16) |
+                         ((n[0] & 0x7F) << 24));
+  } else if (cmd == "joy_button" && numbers(2) && args.size() == 3 &&
+             ParseState(args[2], &release)) {
+    event(kInputJoyButton, (n[1] & 0xFF) | ((n[0] & 0x7F) << 24) | release);
+  } else if (cmd == "quit") {
+    event(kInputQuit, 0xFFFFFFFF);
+  } else {
+    ok = false;
+  }
+
+  if (!ok) {
+    std::cerr << path_ << ":" << line_number << ": invalid command: " << line
+              << "\n";
+  }
+  return ok;
+}
+
+void ScriptInputController::Read() {
+  const auto start = std::chrono::steady_clock::now();
+  auto at = start;
+  uint64_t events = 0;
+  for (const auto& cmd : commands_) {
+    if (shutdown_) break;
+    switch (cmd.kind) {
+      case Command::WAIT_TIME: {
+        // Waits are relative to when the previous command was due, so
+        // replay doesn't drift.
+        at += std::chrono::microseconds(cmd.amount);
+        while (!shutdown_ && std::chrono::steady_clock::now() < at) {
+          std::this_thread::sleep_until(
+              std::min(at, std::chrono::steady_clock::now() +
+                               std::chrono::milliseconds(10)));
+        }
+        break;
+      }
+      case Command::WAIT_INSTRUCTIONS:
+        WaitInstructions(cmd.amount);
+        at = std::chrono::steady_clock::now();
+        break;
+      case Command::EVENT:
+        callback_(cmd.type, cmd.value);
+        ++events;
+        break;
+    }
+  }
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  std::cerr << "Input replay: " << events << " events in " << elapsed.count()
+            << "ms\n";
+}
+
+void ScriptInputController::WaitInstructions(uint64_t count) {
+  if (!instructions_) {
+    std::cerr << "No instruction counter. Ignoring wait.\n";
+    return;
+  }
+  // An idle guest doesn't run instructions, so these waits only make sense
+  // while it is busy.
+  const uint64_t target = instructions_() + count;
+  while (!shutdown_ && instructions_() < target) {
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+}
+
+RecordingInputController::RecordingInputController(InputController* input,
+                                                   const std::string& path)
+    : InputController(), input_(input), out_(path, std::ofstream::trunc),
+      last_(std::chrono::steady_clock::now()) {
+  if (!out_) {
+    std::cerr << "Unable to write input script " << path << "\n";
+  }
+}
+
+void RecordingInputController::Read() {
+  last_ = std::chrono::steady_clock::now();
+  input_->SetInstructionCounter(instructions_);
+  input_->SetCallback([this](uint32_t type, uint32_t value) {
+    Record(type, value);
+    callback_(type, value);
+  });
+  input_->Read();
+}
+
+void RecordingInputController::Shutdown() {
+  shutdown_ = true;
+  input_->Shutdown();
+}
+
+void RecordingInputController::Record(uint32_t type, uint32_t value) {
+  if (!out_) return;
+  const auto now = std::chrono::steady_clock::now();
+  const auto us =
+      std::chrono::duration_cast<std::chrono::microseconds>(now - last_);
+  last_ = now;
+  if (us.count() > 0) out_ << "wait " << us.count() << "us\n";
+
+  const uint32_t state = value >> 31;
+  const int32_t joystick = (value >> 24) & 0x7F;
+  switch (type) {
+    case kInputKeyDown:
+      out_ << "key_down 0x" << std::hex << value << std::dec << "\n";
+      break;
+    case kInputKeyUp:
+      out_ << "key_up 0x" << std::hex << (value & 0x7FFFFFFF) << std::dec
+           << "\n";
+      break;
+    case kInputText: {
+      char utf8[8] = {0};
+      utf8catcodepoint(utf8, value, sizeof(utf8) - 1);
+      const std::string text(utf8);
+      out_ << "text \"";
+      if (text == "\"" || text == "\\") {
+        out_ << "\\" << text;
+      } else if (text == "\n") {
+        out_ << "\\n";
+      } else {
+        out_ << text;
+      }
+      out_ << "\"\n";
+      break;
+    }
+    case kInputQuit:
+      out_ << "quit\n";
+      break;
+    case kInputMouseMotion:
+      out_ << "mouse_motion " << static_cast<int16_t>(value & 0xFFFF) << " "
+           << static_cast<int16_t>(value >> 16) << "\n";
+      break;
+    case kInputMouseButton:
+      out_ << "mouse_button " << (value & 0xFF) << " "
+           << (state ? "up" : "down") << "\n";
+      break;
+    case kInputJoyAxis:
+      out_ << "joy_axis " << joystick << " " << ((value >> 16) & 0xFF) << " "
+           << static_cast<int16_t>(value & 0xFFFF) << "\n";
+      break;
+    case kInputJoyButton:
+      out_ << "joy_button " << joystick << " " << (value & 0xFF) << " "
+           << (state ? "up" : "down") << "\n";
+      break;
+    default:
+      out_ << "# unknown event " << type << " 0x" << std::hex << value
+           << std::dec << "\n";
+      break;
+  }
+  out_.flush();
+}
+
+}  // namespace gvm
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _GVM_SCRIPT_INPUT_CONTROLLER_H_
+#define _GVM_SCRIPT_INPUT_CONTROLLER_H_
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "input_controller.h"
+
+namespace gvm {
+
+// Input scripts have one command per line. Blank lines and lines starting
+// with # are ignored.
+//
+//   wait <n>ms | <n>us | <n>i   Waits n milliseconds or microseconds after
+//                               the previous command, or until the guest has
+//                               run n more instructions.
+//   key_down <code>             Key events. Codes are SDL key codes.
+//   key_up <code>
+//   key <code>                  Key down followed by key up.
+//   text "<utf-8 string>"       One text event per codepoint. Supports \",
+//                               \\ and \n escapes.
+//   mouse_motion <dx> <dy>
+//   mouse_button <n> down|up
+//   joy_axis <joystick> <axis> <value>
+//   joy_button <joystick> <button> down|up
+//   quit
+//
+// Numbers can be decimal or 0x prefixed hex.
+
+// ScriptInputController replays an input script through the same callback
+// the live input controllers use.
+class ScriptInputController : public InputController {
+ public:
+  explicit ScriptInputController(const std::string& path);
+  ~ScriptInputController() override {}
+
+  // Returns false if the script could not be read or parsed.
+  bool Load();
+
+  void Read() override;
+
+ private:
+  struct Command {
+    enum Kind { WAIT_TIME, WAIT_INSTRUCTIONS, EVENT } kind;
+    uint32_t type;
+    uint32_t value;
+    uint64_t amount;  // Microseconds or instructions to wait.
+  };
+
+  bool ParseLine(const std::string& line, int line_number);
+  void WaitInstructions(uint64_t count);
+
+  const std::string path_;
+  std::vector<Command> commands_;
+};
+
+// RecordingInputController passes events from another controller through
+// and writes them to a script, with wall clock waits between them.
+class RecordingInputController : public InputController {
+ public:
+  // Takes ownership of input.
+  RecordingInputController(InputController* input, const std::string& path);
+  ~RecordingInputController() override {}
+
+  void Read() override;
+  void Shutdown() override;
+
+ private:
+  void Record(uint32_t type, uint32_t value);
+
+  std::unique_ptr<InputController> input_;
+  std::ofstream out_;
+  std::chrono::steady_clock::time_point last_;
+};
+
+}  // namespace gvm
+
+#endif  // _GVM_SCRIPT_INPUT_CONTROLLER_H_
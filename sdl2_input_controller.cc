@@ -16,7 +16,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-#include "input_controller.h"
+#include "sdl2_input_controller.h"
 
 #include <cassert>
 #include <iostream>
@@ -27,15 +27,18 @@
 
 namespace gvm {
 
-InputController::InputController(std::function<void(uint32_t value)> callback)
-    : shutdown_(false), callback_(callback) {
+SDL2InputController::SDL2InputController() : InputController() {
   if (SDL_Init(SDL_INIT_EVENTS | SDL_INIT_JOYSTICK) < 0) {
     std::cerr << SDL_GetError() << std::endl;
     assert(false);
   }
 }
 
-InputController::~InputController() {}
+SDL2InputController::~SDL2InputController() {
+  for (auto& kv : joysticks_) {
+    SDL_JoystickClose(kv.second);
+  }
+}
 
 
 static bool IsControlKey(uint32_t sym) {
@@ -72,7 +75,7 @@ static bool IsControlKey(uint32_t sym) {
 }
 
 
-void InputController::Read() {
+void SDL2InputController::Read() {
   SDL_Event event;
   while (!shutdown_) {
     if (!SDL_WaitEvent(&event)) continue;
@@ -80,13 +83,13 @@ void InputController::Read() {
     // Event available
     switch (event.type) {
       case SDL_QUIT: {
-        callback_(0xFFFFFFFF);
+        callback_(kInputQuit, 0xFFFFFFFF);
         shutdown_ = true;
         break;
       }
       case SDL_KEYDOWN: {
         const uint32_t sym = event.key.keysym.sym;
-        if (IsControlKey(sym)) callback_(sym);
+        if (IsControlKey(sym)) callback_(kInputKeyDown, sym);
         break;
       }
       case SDL_KEYUP: {
@@ -94,7 +97,7 @@ void InputController::Read() {
         std::cerr << "Keyup: " << sym << std::endl;
         if (IsControlKey(sym)) {
             sym |= (1 << 31);
-            callback_(sym);
+            callback_(kInputKeyUp, sym);
         }
         break;
       }
@@ -103,7 +106,54 @@ void InputController::Read() {
         const char* text = event.text.text;
         int codepoint = 0;
         utf8codepoint(text, &codepoint);
-        callback_(static_cast<uint32_t>(codepoint));
+        callback_(kInputText, static_cast<uint32_t>(codepoint));
+        break;
+      }
+
+      // Motion and axis events can arrive at a high rate. The input fifo
+      // coalesces them, so they are all forwarded here.
+      case SDL_MOUSEMOTION: {
+        const uint32_t dx = static_cast<uint16_t>(event.motion.xrel);
+        const uint32_t dy = static_cast<uint16_t>(event.motion.yrel);
+        callback_(kInputMouseMotion, dx | (dy << 16));
+        break;
+      }
+      case SDL_MOUSEBUTTONDOWN:
+      case SDL_MOUSEBUTTONUP: {
+        uint32_t value = event.button.button;
+        if (event.type == SDL_MOUSEBUTTONUP) value |= (1 << 31);
+        callback_(kInputMouseButton, value);
+        break;
+      }
+      case SDL_JOYDEVICEADDED: {
+        SDL_Joystick* joystick = SDL_JoystickOpen(event.jdevice.which);
+        if (joystick != nullptr) {
+          joysticks_[SDL_JoystickInstanceID(joystick)] = joystick;
+        }
+        break;
+      }
+      case SDL_JOYDEVICEREMOVED: {
+        auto it = joysticks_.find(event.jdevice.which);
+        if (it != joysticks_.end()) {
+          SDL_JoystickClose(it->second);
+          joysticks_.erase(it);
+        }
+        break;
+      }
+      case SDL_JOYAXISMOTION: {
+        const uint32_t value =
+            static_cast<uint16_t>(event.jaxis.value) |
+            (static_cast<uint32_t>(event.jaxis.axis) << 16) |
+            ((static_cast<uint32_t>(event.jaxis.which) & 0x7F) << 24);
+        callback_(kInputJoyAxis, value);
+        break;
+      }
+      case SDL_JOYBUTTONDOWN:
+      case SDL_JOYBUTTONUP: {
+        uint32_t value = event.jbutton.button |
+            ((static_cast<uint32_t>(event.jbutton.which) & 0x7F) << 24);
+        if (event.type == SDL_JOYBUTTONUP) value |= (1 << 31);
+        callback_(kInputJoyButton, value);
         break;
       }
       default:
@@ -112,4 +162,12 @@ void InputController::Read() {
   }
 }
 
+void SDL2InputController::Shutdown() {
+  shutdown_ = true;
+  // Wakes up Read if it is waiting for an event.
+  SDL_Event ev;
+  ev.type = SDL_QUIT;
+  SDL_PushEvent(&ev);
+}
+
 }  // namespace gvm
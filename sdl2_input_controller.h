@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _GVM_SDL2_INPUT_CONTROLLER_H_
+#define _GVM_SDL2_INPUT_CONTROLLER_H_
+
+#include <map>
+#include <SDL2/SDL.h>
+
+#include "input_controller.h"
+
+namespace gvm {
+
+class SDL2InputController : public InputController {
+ public:
+  SDL2InputController();
+  ~SDL2InputController() override;
+
+  void Read() override;
+  void Shutdown() override;
+
+ private:
+  std::map<SDL_JoystickID, SDL_Joystick*> joysticks_;
+};
+
+}  // namespace gvm
+
+#endif  // _GVM_SDL2_INPUT_CONTROLLER_H_
@@ -18,10 +18,14 @@
 
 #include "sdl2_video_display.h"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cstring>
 #include <iostream>
 
+#include "pixel_kernels.h"
+
 namespace gvm {
 
 SDL2VideoDisplay::SDL2VideoDisplay() : SDL2VideoDisplay(800, 600, true, "") {}
@@ -33,15 +37,8 @@ SDL2VideoDisplay::SDL2VideoDisplay(int width, int height)
 
 SDL2VideoDisplay::SDL2VideoDisplay(
     int width, int height, const bool fullscreen, const std::string force_driver)
-  : texture_(nullptr) {
-
-  // The text buffer is 100x28 chars wide, with each char uisng 4 bytes (2 for
-  // char, 1 for fgcolor, 1 for bg color.
-  text_vram_buffer_ = new uint32_t[100*28];
-  text_pixels_ = new uint32_t[800*450];
-  memset(text_vram_buffer_, 0, sizeof(uint32_t)*100*28);
-  memset(text_pixels_, 0, sizeof(uint32_t)*800*450);
-
+  : texture_(nullptr), text_texture_(nullptr), use_surface_(false),
+    scale_ns_(0), scale_frames_(0), scale_factor_(0) {
   const auto flags = fullscreen
       ? SDL_WINDOW_ALLOW_HIGHDPI | SDL_WINDOW_FULLSCREEN
       : SDL_WINDOW_ALLOW_HIGHDPI;
@@ -86,17 +83,23 @@ SDL2VideoDisplay::SDL2VideoDisplay(
   renderer_ = SDL_CreateRenderer(window_, drv_index, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
   if (renderer_ == nullptr) {
     SDL_Log("%s", SDL_GetError());
-    std::cerr << "Hardware acceleration unavailable. Fallback to software.\n";
-    renderer_ = SDL_CreateRenderer(window_, -1, SDL_RENDERER_SOFTWARE);
+    std::cerr << "Hardware acceleration unavailable. Using the integer "
+                 "scaler.\n";
+    use_surface_ = true;
   }
 }
 
 SDL2VideoDisplay::~SDL2VideoDisplay() {
-  delete [] text_vram_buffer_;
-  delete [] text_pixels_;
-  SDL_DestroyTexture(texture_);
-  SDL_DestroyTexture(text_texture_);
-  SDL_DestroyRenderer(renderer_);
+  if (scale_frames_ != 0) {
+    std::cerr << "Integer scaler: " << scale_factor_ << "x, "
+              << (scale_ns_ / static_cast<double>(scale_frames_) / 1000000)
+              << " ms/frame\n";
+  }
+  if (!use_surface_) {
+    SDL_DestroyTexture(texture_);
+    SDL_DestroyTexture(text_texture_);
+    SDL_DestroyRenderer(renderer_);
+  }
   SDL_DestroyWindow(window_);
   SDL_Quit();
 }
@@ -107,6 +110,11 @@ void SDL2VideoDisplay::SetFramebufferSize(int fWidth, int fHeight, int bpp) {
   assert(bpp == 32);
   fWidth_ = fWidth;
   fHeight_ = fHeight;
+  if (use_surface_) {
+    graphics_.assign(fWidth * fHeight, 0);
+    text_.assign(Rasterizer::kTextWidth * Rasterizer::kTextHeight, 0);
+    return;
+  }
   texture_ = SDL_CreateTexture(
       renderer_, SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_STREAMING, fWidth, fHeight);
   assert(texture_ != nullptr);
@@ -116,7 +124,12 @@ void SDL2VideoDisplay::SetFramebufferSize(int fWidth, int fHeight, int bpp) {
 }
 
 void SDL2VideoDisplay::CopyBuffer(uint32_t* mem, uint32_t mode) {
-  if (mode == 1) {
+  if (use_surface_ &&
+      (mode == kGraphicsMode || mode == kIndexedGraphicsMode)) {
+    raster_.CopyGraphics(mem, mode, fWidth_, fHeight_,
+                         reinterpret_cast<uint8_t*>(graphics_.data()),
+                         fWidth_ * sizeof(uint32_t));
+  } else if (mode == kGraphicsMode || mode == kIndexedGraphicsMode) {
     int pitch;
     void* pixels = nullptr;
     if (SDL_LockTexture(texture_,  nullptr, &pixels, &pitch) != 0) {
@@ -124,21 +137,30 @@ void SDL2VideoDisplay::CopyBuffer(uint32_t* mem, uint32_t mode) {
       assert(false);
     }
     assert(pixels != nullptr);
-    std::memcpy(pixels, mem, pitch * fHeight_);
+    raster_.CopyGraphics(mem, mode, fWidth_, fHeight_,
+                         reinterpret_cast<uint8_t*>(pixels), pitch);
     SDL_UnlockTexture(texture_);
-  } else if (mode == 2) {
-    std::memcpy(text_vram_buffer_, mem, sizeof(uint32_t)*100*28);
+  } else if (mode == kTextMode) {
+    raster_.UpdateText(mem);
   }
 }
 
+void SDL2VideoDisplay::SetTextState(uint32_t first_row, uint32_t cursor) {
+  raster_.SetTextState(first_row, cursor);
+}
+
 void SDL2VideoDisplay::Render(uint32_t mode) {
+  if (use_surface_) {
+    SurfaceRender(mode);
+    return;
+  }
   if (SDL_RenderClear(renderer_) != 0) {
     std::cerr << "RendererClear: " << SDL_GetError() << std::endl;
   }
 
-  if (mode == 1) {
+  if (mode == kGraphicsMode || mode == kIndexedGraphicsMode) {
     GraphicsRender();
-  } else if (mode == 2) {
+  } else if (mode == kTextMode) {
     TextRender();
   }
 
@@ -154,52 +176,112 @@ void SDL2VideoDisplay::GraphicsRender() {
   }
 }
 
-static void renderChar(
-    uint32_t ch, uint32_t fg, uint32_t bg, int x, int y,
-    uint32_t* text_rom,  uint32_t* vram_pixels) {
-    const uint32_t line_size = 800;
-    const uint32_t char_width = 8;
-    uint32_t* char_word = &text_rom[ch << 2];
-    uint32_t idx = y * line_size * 16 + x * char_width - line_size;
-    for (int w = 0; w < 4; ++w) {
-        uint32_t word = char_word[w];
-        for (uint32_t i = 0; i < sizeof(uint32_t)*char_width; ++i) {
-            if (i % 8 == 0) {
-                idx += line_size + char_width;
-            }
-            auto c = (word >> i) & 0x01;
-            vram_pixels[--idx] = c == 0 ? bg : fg;
-        }
+void SDL2VideoDisplay::TextRender() {
+  const int kWidth = Rasterizer::kTextWidth;
+  const int kCharHeight = Rasterizer::kCharHeight;
+  int first_dirty;
+  int last_dirty;
+  if (raster_.DrawText(&first_dirty, &last_dirty)) {
+    SDL_Rect rect = {0, first_dirty * kCharHeight, kWidth,
+                     (last_dirty - first_dirty + 1) * kCharHeight};
+    int pitch;
+    void* pixels = nullptr;
+    if (SDL_LockTexture(text_texture_,  &rect, &pixels, &pitch) != 0) {
+      std::cerr << SDL_GetError() << "\n";
+      assert(false);
     }
-}
+    assert(pixels != nullptr);
+    const uint32_t* text_pixels = raster_.text_pixels();
+    for (int y = 0; y < rect.h; ++y) {
+      std::memcpy(reinterpret_cast<uint8_t*>(pixels) + y * pitch,
+                  &text_pixels[(rect.y + y) * kWidth], sizeof(uint32_t) * kWidth);
+    }
+    SDL_UnlockTexture(text_texture_);
+  }
 
-void SDL2VideoDisplay::TextRender() {
-  for (int y = 0; y < 28; ++y) {
-    for (int x = 0; x < 100; ++x) {
-      const auto i = y*100 + x;
-      const auto ch = text_vram_buffer_[i] & 0xFFFF;
-      const auto fg = color_table_[(text_vram_buffer_[i] >> 16) & 0xFF];
-      const auto bg = color_table_[(text_vram_buffer_[i] >> 24) & 0xFF];
-      renderChar(ch, fg, bg, x, y, text_rom_, text_pixels_);
+  // The ring is shown in two parts: from the first row to the end of the
+  // texture at the top of the screen, then the rows before it.
+  int outW;
+  int outH;
+  if (SDL_GetRendererOutputSize(renderer_, &outW, &outH) != 0) {
+    outW = maxW_;
+    outH = maxH_;
+  }
+  const int split = raster_.text_first_row() * 16;
+  const int top = 28 * 16 - split;
+  SDL_Rect src_top = {0, split, 800, top};
+  SDL_Rect dst_top = {0, 0, outW, top * outH / 450};
+  SDL_Rect src_bottom = {0, 0, 800, split};
+  SDL_Rect dst_bottom = {0, dst_top.h, outW, split * outH / 450};
+  int err = SDL_RenderCopy(renderer_, text_texture_, &src_top, &dst_top);
+  if (err == 0 && split != 0) {
+    err = SDL_RenderCopy(renderer_, text_texture_, &src_bottom, &dst_bottom);
+  }
+  if (err != 0) {
+    if (count_ % 20000 == 0) {
+      std::cerr << "RenderCopy: " << SDL_GetError() << std::endl;
     }
+    ++count_;
   }
+}
 
-  int pitch;
-  void* pixels = nullptr;
-  if (SDL_LockTexture(text_texture_,  nullptr, &pixels, &pitch) != 0) {
-    std::cerr << SDL_GetError() << "\n";
-    assert(false);
+void SDL2VideoDisplay::SurfaceRender(uint32_t mode) {
+  const uint32_t* src = graphics_.data();
+  int width = fWidth_;
+  int height = fHeight_;
+  if (mode == kTextMode) {
+    int first_dirty;
+    int last_dirty;
+    raster_.DrawText(&first_dirty, &last_dirty);
+    raster_.ResolveText(text_.data());
+    src = text_.data();
+    width = Rasterizer::kTextWidth;
+    height = Rasterizer::kTextHeight;
+  } else if (mode != kGraphicsMode && mode != kIndexedGraphicsMode) {
+    return;
   }
-  assert(pixels != nullptr);
-  std::memcpy(pixels, text_pixels_, pitch * 450);
-  SDL_UnlockTexture(text_texture_);
 
-  if (SDL_RenderCopy(renderer_, text_texture_, nullptr, nullptr) != 0) {
+  // The window surface can change when the window does, so get it each frame.
+  SDL_Surface* surface = SDL_GetWindowSurface(window_);
+  if (surface == nullptr || surface->format->BytesPerPixel != 4) {
     if (count_ % 20000 == 0) {
-      std::cerr << "RenderCopy: " << SDL_GetError() << std::endl;
+      std::cerr << "Unusable window surface: " << SDL_GetError() << std::endl;
     }
     ++count_;
+    return;
+  }
+  const uint32_t format = surface->format->format;
+  const bool swap_rb = format != SDL_PIXELFORMAT_ABGR8888 &&
+                       format != SDL_PIXELFORMAT_BGR888;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  int factor = std::min(std::min(surface->w / width, surface->h / height), 4);
+  if (factor < 1) factor = 1;
+  const int out_w = std::min(width * factor, surface->w);
+  const int out_h = std::min(height * factor, surface->h);
+  const int off_x = (surface->w - out_w) / 2;
+  const int off_y = (surface->h - out_h) / 2;
+  scaled_row_.resize(width * factor);
+
+  if (SDL_MUSTLOCK(surface)) SDL_LockSurface(surface);
+  uint8_t* pixels = reinterpret_cast<uint8_t*>(surface->pixels);
+  const size_t out_size = out_w * sizeof(uint32_t);
+  for (int y = 0; y < out_h / factor; ++y) {
+    ScaleRow32(&src[y * width], width, factor, swap_rb, scaled_row_.data());
+    for (int r = 0; r < factor; ++r) {
+      uint8_t* dst = pixels + (off_y + y * factor + r) * surface->pitch +
+                     off_x * sizeof(uint32_t);
+      std::memcpy(dst, scaled_row_.data(), out_size);
+    }
   }
+  if (SDL_MUSTLOCK(surface)) SDL_UnlockSurface(surface);
+  SDL_UpdateWindowSurface(window_);
+
+  const std::chrono::nanoseconds runtime =
+      std::chrono::high_resolution_clock::now() - start;
+  scale_ns_ += runtime.count();
+  ++scale_frames_;
+  scale_factor_ = factor;
 }
 
 bool SDL2VideoDisplay::CheckEvents() {
@@ -20,7 +20,9 @@
 #define _GVM_SDL2_VIDEO_DISPLAY_H_
 
 #include <SDL2/SDL.h>
+#include <vector>
 
+#include "rasterizer.h"
 #include "video_display.h"
 
 namespace gvm {
@@ -34,15 +36,18 @@ class SDL2VideoDisplay : public VideoDisplay {
   ~SDL2VideoDisplay() override;
 
   void SetFramebufferSize(int fWidth, int fHeight, int bpp) override;
-  void SetTextRom(uint32_t* mem) override { text_rom_ = mem; }
-  void SetColorTable(uint32_t* mem) override { color_table_ = mem; }
+  void SetTextRom(uint32_t* mem) override { raster_.SetTextRom(mem); }
+  void SetColorTable(uint32_t* mem) override { raster_.SetColorTable(mem); }
   void CopyBuffer(uint32_t* mem, uint32_t mode) override;
+  void SetTextState(uint32_t first_row, uint32_t cursor) override;
   void Render(uint32_t mode) override;
   bool CheckEvents() override;
+  bool HasWindow() const override { return true; }
 
  private:
   void GraphicsRender();
   void TextRender();
+  void SurfaceRender(uint32_t mode);
 
   SDL_Window* window_;
   SDL_Renderer* renderer_;
@@ -53,10 +58,17 @@ class SDL2VideoDisplay : public VideoDisplay {
   int fWidth_;
   int fHeight_;
   int count_;
-  uint32_t* color_table_;
-  uint32_t* text_rom_;
-  uint32_t* text_vram_buffer_;
-  uint32_t* text_pixels_;
+  Rasterizer raster_;
+
+  // Without an accelerated renderer, frames are scaled by an integer factor
+  // straight into the window surface instead of going through SDL's scaler.
+  bool use_surface_;
+  std::vector<uint32_t> graphics_;
+  std::vector<uint32_t> text_;
+  std::vector<uint32_t> scaled_row_;
+  uint64_t scale_ns_;
+  uint64_t scale_frames_;
+  int scale_factor_;
 };
 
 }  // namespace gvm
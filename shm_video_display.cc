@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "shm_video_display.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace gvm {
+
+constexpr uint32_t ShmVideoDisplay::kSlotCount;
+
+ShmVideoDisplay::ShmVideoDisplay(const std::string& name)
+    : name_(name),
+      text_(Rasterizer::kTextWidth * Rasterizer::kTextHeight, 0),
+      last_width_(0), last_height_(0), fWidth_(0), fHeight_(0),
+      pending_(false), map_(nullptr), map_size_(0), slot_size_(0),
+      frame_count_(0) {}
+
+ShmVideoDisplay::~ShmVideoDisplay() {
+  if (map_ != nullptr) {
+    munmap(map_, map_size_);
+    shm_unlink(name_.c_str());
+  }
+}
+
+void ShmVideoDisplay::SetFramebufferSize(int fWidth, int fHeight, int bpp) {
+  assert(bpp == 32);
+  assert(map_ == nullptr);
+  fWidth_ = fWidth;
+  fHeight_ = fHeight;
+  graphics_.assign(fWidth * fHeight, 0);
+
+  slot_size_ = std::max(fWidth * fHeight,
+                        Rasterizer::kTextWidth * Rasterizer::kTextHeight) *
+               sizeof(uint32_t);
+  map_size_ = sizeof(ShmRingHeader) +
+              kSlotCount * (sizeof(ShmSlotHeader) + slot_size_);
+  const int fd = shm_open(name_.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+  if (fd < 0) {
+    std::cerr << "shm_open " << name_ << ": " << strerror(errno) << "\n";
+    return;
+  }
+  if (ftruncate(fd, map_size_) != 0) {
+    std::cerr << "ftruncate " << name_ << ": " << strerror(errno) << "\n";
+    close(fd);
+    return;
+  }
+  void* map = mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    std::cerr << "mmap " << name_ << ": " << strerror(errno) << "\n";
+    return;
+  }
+  map_ = reinterpret_cast<uint8_t*>(map);
+
+  auto* header = reinterpret_cast<ShmRingHeader*>(map_);
+  header->version = kShmVersion;
+  header->slot_count = kSlotCount;
+  header->slot_size = slot_size_;
+  header->latest_slot = 0;
+  header->frame_count = 0;
+  // Viewers check the magic last, so they never see a half built header.
+  __atomic_store_n(&header->magic, kShmMagic, __ATOMIC_RELEASE);
+}
+
+void ShmVideoDisplay::CopyBuffer(uint32_t* mem, uint32_t mode) {
+  if (mode == kGraphicsMode || mode == kIndexedGraphicsMode) {
+    raster_.CopyGraphics(mem, mode, fWidth_, fHeight_,
+                         reinterpret_cast<uint8_t*>(graphics_.data()),
+                         fWidth_ * sizeof(uint32_t));
+  } else if (mode == kTextMode) {
+    raster_.UpdateText(mem);
+  }
+  pending_ = true;
+}
+
+void ShmVideoDisplay::SetTextState(uint32_t first_row, uint32_t cursor) {
+  raster_.SetTextState(first_row, cursor);
+}
+
+void ShmVideoDisplay::Render(uint32_t mode) {
+  if (!pending_ || map_ == nullptr) return;
+  pending_ = false;
+
+  if (mode == kTextMode) {
+    int first_dirty;
+    int last_dirty;
+    raster_.DrawText(&first_dirty, &last_dirty);
+    raster_.ResolveText(text_.data());
+    Publish(text_.data(), mode, Rasterizer::kTextWidth,
+            Rasterizer::kTextHeight);
+  } else if (mode == kGraphicsMode || mode == kIndexedGraphicsMode) {
+    Publish(graphics_.data(), mode, fWidth_, fHeight_);
+  }
+}
+
+void ShmVideoDisplay::FindDirtyRects(const uint32_t* pixels, int width,
+                                     int height, ShmSlotHeader* slot) {
+  slot->dirty_count = 0;
+  if (width != last_width_ || height != last_height_) {
+    slot->dirty[0] = {0, 0, static_cast<uint32_t>(width),
+                      static_cast<uint32_t>(height)};
+    slot->dirty_count = 1;
+    return;
+  }
+
+  // Runs of changed rows become full width rects. If there are more runs than
+  // rects, the last rect grows to cover the rest.
+  const size_t row_size = width * sizeof(uint32_t);
+  int start = -1;
+  for (int y = 0; y <= height; ++y) {
+    const bool changed = y < height &&
+        std::memcmp(&pixels[y * width], &last_[y * width], row_size) != 0;
+    if (changed && start == -1) {
+      start = y;
+    } else if (!changed && start != -1) {
+      if (slot->dirty_count == kShmMaxDirtyRects) {
+        ShmRect& rect = slot->dirty[kShmMaxDirtyRects - 1];
+        rect.h = y - rect.y;
+      } else {
+        slot->dirty[slot->dirty_count++] = {
+            0, static_cast<uint32_t>(start), static_cast<uint32_t>(width),
+            static_cast<uint32_t>(y - start)};
+      }
+      start = -1;
+    }
+  }
+}
+
+void ShmVideoDisplay::Publish(const uint32_t* pixels, uint32_t mode,
+                              int width, int height) {
+  auto* header = reinterpret_cast<ShmRingHeader*>(map_);
+  const uint32_t index = frame_count_ % kSlotCount;
+  uint8_t* base = map_ + sizeof(ShmRingHeader) +
+                  index * (sizeof(ShmSlotHeader) + slot_size_);
+  auto* slot = reinterpret_cast<ShmSlotHeader*>(base);
+  uint32_t* dst = reinterpret_cast<uint32_t*>(base + sizeof(ShmSlotHeader));
+
+  const uint32_t seq = slot->seq;
+  __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  slot->mode = mode;
+  slot->width = width;
+  slot->height = height;
+  slot->frame = frame_count_;
+  FindDirtyRects(pixels, width, height, slot);
+  std::memcpy(dst, pixels, width * height * sizeof(uint32_t));
+  __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+
+  ++frame_count_;
+  __atomic_store_n(&header->latest_slot, index, __ATOMIC_RELEASE);
+  __atomic_store_n(&header->frame_count, frame_count_, __ATOMIC_RELEASE);
+
+  last_.assign(pixels, pixels + width * height);
+  last_width_ = width;
+  last_height_ = height;
+}
+
+}  // namespace gvm
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _GVM_SHM_VIDEO_DISPLAY_H_
+#define _GVM_SHM_VIDEO_DISPLAY_H_
+
+#include <string>
+#include <vector>
+
+#include "rasterizer.h"
+#include "video_display.h"
+
+namespace gvm {
+
+// Layout of the POSIX shared memory object written by ShmVideoDisplay. It is
+// a ShmRingHeader followed by slot_count slots, each a ShmSlotHeader followed
+// by slot_size bytes of ABGR8888 pixels in screen order.
+//
+// Each slot is guarded by a seqlock: seq is odd while the slot is written.
+// A viewer reads latest_slot, then seq, then the slot, then seq again, and
+// retries if seq was odd or changed. The writer never waits for viewers.
+constexpr uint32_t kShmMagic = 0x464D5647;  // "GVMF"
+constexpr uint32_t kShmVersion = 1;
+constexpr uint32_t kShmMaxDirtyRects = 16;
+
+struct ShmRingHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slot_count;
+  uint32_t slot_size;
+  uint32_t latest_slot;  // Slot of the last complete frame.
+  uint32_t reserved;
+  uint64_t frame_count;  // Frames published so far.
+};
+
+struct ShmRect {
+  uint32_t x;
+  uint32_t y;
+  uint32_t w;
+  uint32_t h;
+};
+
+struct ShmSlotHeader {
+  uint32_t seq;
+  uint32_t mode;
+  uint32_t width;
+  uint32_t height;
+  uint64_t frame;
+  // Regions that changed since the previous frame.
+  uint32_t dirty_count;
+  uint32_t reserved;
+  ShmRect dirty[kShmMaxDirtyRects];
+};
+
+// ShmVideoDisplay publishes finished frames to a shared memory ring so
+// external viewers can watch a VM without it owning a window.
+class ShmVideoDisplay : public VideoDisplay {
+ public:
+  static constexpr uint32_t kSlotCount = 3;
+
+  // name is the shared memory object name, e.g. "/gvm0".
+  explicit ShmVideoDisplay(const std::string& name);
+  ~ShmVideoDisplay() override;
+
+  void SetFramebufferSize(int fWidth, int fHeight, int bpp) override;
+  void SetTextRom(uint32_t* mem) override { raster_.SetTextRom(mem); }
+  void SetColorTable(uint32_t* mem) override { raster_.SetColorTable(mem); }
+  void CopyBuffer(uint32_t* mem, uint32_t mode) override;
+  void SetTextState(uint32_t first_row, uint32_t cursor) override;
+  void Render(uint32_t mode) override;
+  bool CheckEvents() override { return false; }
+
+ private:
+  void Publish(const uint32_t* pixels, uint32_t mode, int width, int height);
+  void FindDirtyRects(const uint32_t* pixels, int width, int height,
+                      ShmSlotHeader* slot);
+
+  const std::string name_;
+  Rasterizer raster_;
+  std::vector<uint32_t> graphics_;
+  std::vector<uint32_t> text_;
+  std::vector<uint32_t> last_;  // Last frame published.
+  int last_width_;
+  int last_height_;
+  int fWidth_;
+  int fHeight_;
+  bool pending_;
+  uint8_t* map_;
+  size_t map_size_;
+  uint32_t slot_size_;
+  uint64_t frame_count_;
+};
+
+}  // namespace gvm
+
+#endif  // _GVM_SHM_VIDEO_DISPLAY_H_
@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "stats.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace gvm {
+
+namespace {
+
+const char kUnixPrefix[] = "unix:";
+
+// Counts print as integers, anything else with enough digits to round trip
+// the values we produce.
+void WriteValue(std::ostream& out, double value, const char* nan) {
+  if (!std::isfinite(value)) {
+    out << nan;
+  } else if (value == std::floor(value) && std::fabs(value) < 1e15) {
+    out << static_cast<int64_t>(value);
+  } else {
+    out << std::setprecision(9) << value;
+  }
+}
+
+// Reads a JSON string at pos, which must be its opening quote, into out.
+bool ReadString(const std::string& json, size_t* pos, std::string* out) {
+  if (json[*pos] != '"') return false;
+  out->clear();
+  for (size_t i = *pos + 1; i < json.size(); ++i) {
+    if (json[i] == '"') {
+      *pos = i + 1;
+      return true;
+    }
+    if (json[i] == '\\' && ++i == json.size()) break;
+    out->push_back(json[i]);
+  }
+  return false;
+}
+
+void SkipSpace(const std::string& json, size_t* pos) {
+  while (*pos < json.size() && std::isspace(json[*pos])) ++*pos;
+}
+
+}  // namespace
+
+bool Stats::ReadJson(const std::string& path,
+                     std::map<std::string, std::string>* values) {
+  std::ifstream in(path);
+  if (!in) {
+    std::cerr << "Unable to read " << path << "\n";
+    return false;
+  }
+  std::stringstream ss;
+  ss << in.rdbuf();
+  const std::string json = ss.str();
+  size_t pos = 0;
+  SkipSpace(json, &pos);
+  bool ok = pos < json.size() && json[pos++] == '{';
+  SkipSpace(json, &pos);
+  if (ok && pos < json.size() && json[pos] == '}') return true;
+  while (ok) {
+    std::string name;
+    std::string value;
+    SkipSpace(json, &pos);
+    ok = pos < json.size() && ReadString(json, &pos, &name);
+    SkipSpace(json, &pos);
+    ok = ok && pos < json.size() && json[pos++] == ':';
+    SkipSpace(json, &pos);
+    if (!ok || pos == json.size()) break;
+    if (json[pos] == '"') {
+      ok = ReadString(json, &pos, &value);
+    } else {
+      const size_t end = json.find_first_of(",}", pos);
+      ok = end != std::string::npos;
+      if (ok) value = json.substr(pos, end - pos);
+      while (!value.empty() && std::isspace(value.back())) value.pop_back();
+      pos = end;
+    }
+    (*values)[name] = value;
+    SkipSpace(json, &pos);
+    if (!ok || pos == json.size()) break;
+    const char next = json[pos++];
+    if (next == '}') return true;
+    ok = next == ',';
+  }
+  std::cerr << "Malformed JSON object in " << path << "\n";
+  return false;
+}
+
+void Stats::AddCounter(const std::string& name, const std::string& help,
+                       Reader read) {
+  metrics_.push_back({name, help, true, read});
+}
+
+void Stats::AddGauge(const std::string& name, const std::string& help,
+                     Reader read) {
+  metrics_.push_back({name, help, false, read});
+}
+
+void Stats::WriteJson(std::ostream& out) const {
+  out << "{";
+  for (size_t i = 0; i < metrics_.size(); ++i) {
+    const Metric& metric = metrics_[i];
+    out << (i == 0 ? "\n  \"" : ",\n  \"") << metric.name << "\": ";
+    WriteValue(out, metric.read(), "null");
+  }
+  out << "\n}\n";
+}
+
+void Stats::WritePrometheus(std::ostream& out) const {
+  for (const Metric& metric : metrics_) {
+    out << "# HELP " << metric.name << " " << metric.help << "\n";
+    out << "# TYPE " << metric.name << " "
+        << (metric.counter ? "counter" : "gauge") << "\n";
+    out << metric.name << " ";
+    WriteValue(out, metric.read(), "NaN");
+    out << "\n";
+  }
+}
+
+StatsExporter::StatsExporter(const Stats* stats, const std::string& target,
+                             std::chrono::milliseconds period)
+    : stats_(stats), path_(target), socket_(false),
+      period_(std::max(period, std::chrono::milliseconds(1))), fd_(-1),
+      shutdown_(false) {
+  assert(stats_ != nullptr);
+  if (path_.compare(0, sizeof(kUnixPrefix) - 1, kUnixPrefix) == 0) {
+    path_ = path_.substr(sizeof(kUnixPrefix) - 1);
+    socket_ = true;
+  }
+}
+
+StatsExporter::~StatsExporter() {
+  if (fd_ == -1) return;
+  close(fd_);
+  unlink(path_.c_str());
+}
+
+bool StatsExporter::Init() {
+  if (!socket_) return true;
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (path_.size() >= sizeof(addr.sun_path)) {
+    std::cerr << "Stats socket path too long: " << path_ << "\n";
+    return false;
+  }
+  strcpy(addr.sun_path, path_.c_str());
+  fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd_ == -1) {
+    std::cerr << "Unable to create stats socket: " << strerror(errno) << "\n";
+    return false;
+  }
+  // A socket left behind by an earlier run would make bind fail.
+  unlink(path_.c_str());
+  if (bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1 ||
+      listen(fd_, 8) == -1) {
+    std::cerr << "Unable to listen on " << path_ << ": " << strerror(errno)
+              << "\n";
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  return true;
+}
+
+void StatsExporter::Start() {
+  if (socket_) {
+    Serve();
+    return;
+  }
+  auto next = std::chrono::steady_clock::now();
+  while (!shutdown_) {
+    WriteFile();
+    next += period_;
+    signal_.WaitUntil(next);
+  }
+  WriteFile();
+}
+
+void StatsExporter::Stop() {
+  shutdown_ = true;
+  signal_.Close();
+  // Wakes up the poll in Serve.
+  if (fd_ != -1) shutdown(fd_, SHUT_RDWR);
+}
+
+bool StatsExporter::WriteFile() const {
+  // Readers must never see a partial snapshot, so write a new file and
+  // rename it over the old one.
+  const std::string tmp = path_ + ".tmp";
+  {
+    std::ofstream out(tmp);
+    stats_->WritePrometheus(out);
+    if (!out) {
+      std::cerr << "Unable to write stats to " << tmp << "\n";
+      return false;
+    }
+  }
+  return std::rename(tmp.c_str(), path_.c_str()) == 0;
+}
+
+void StatsExporter::Serve() {
+  if (fd_ == -1) return;
+  pollfd pfd = {fd_, POLLIN, 0};
+  while (!shutdown_) {
+    if (poll(&pfd, 1, period_.count()) <= 0) continue;
+    const int client = accept(fd_, nullptr, nullptr);
+    if (client == -1) continue;
+    std::stringstream snapshot;
+    stats_->WritePrometheus(snapshot);
+    const std::string text = snapshot.str();
+    size_t sent = 0;
+    while (sent < text.size()) {
+      const ssize_t n = send(client, text.data() + sent, text.size() - sent,
+                             MSG_NOSIGNAL);
+      if (n <= 0) break;
+      sent += n;
+    }
+    close(client);
+  }
+}
+
+}  // namespace gvm
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _GVM_STATS_H_
+#define _GVM_STATS_H_
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "sync_types.h"
+
+namespace gvm {
+
+// Stats is a registry of named counters and gauges. Components keep their
+// own values and register a function reading them, which the exporter calls
+// from its own thread while the machine runs, so readers must only load
+// values written by other threads atomically or tolerate stale ones. Names
+// follow Prometheus conventions: snake case, counters end in _total and
+// times are in seconds.
+class Stats {
+ public:
+  typedef std::function<double()> Reader;
+
+  void AddCounter(const std::string& name, const std::string& help,
+                  Reader read);
+  void AddGauge(const std::string& name, const std::string& help,
+                Reader read);
+
+  // Writes every value as a single flat JSON object.
+  void WriteJson(std::ostream& out) const;
+  // Writes every value in the Prometheus text exposition format.
+  void WritePrometheus(std::ostream& out) const;
+
+  // Reads a flat JSON object, like the one WriteJson writes, into values.
+  // Strings are unquoted, anything else is kept as written. Returns false
+  // if the file can't be read or isn't a flat object.
+  static bool ReadJson(const std::string& path,
+                       std::map<std::string, std::string>* values);
+
+ private:
+  struct Metric {
+    std::string name;
+    std::string help;
+    bool counter;
+    Reader read;
+  };
+
+  std::vector<Metric> metrics_;
+};
+
+// StatsExporter publishes Prometheus snapshots of stats while the machine
+// runs. If target is "unix:<path>", every client connecting to the unix
+// domain socket at path gets the current snapshot. Otherwise the file at
+// target is replaced with a new snapshot every period and once more on Stop.
+class StatsExporter {
+ public:
+  StatsExporter(const Stats* stats, const std::string& target,
+                std::chrono::milliseconds period);
+  ~StatsExporter();
+
+  // Creates the socket, if any. Returns false if it can't be created.
+  bool Init();
+
+  // Publishes snapshots until Stop is called.
+  void Start();
+  void Stop();
+
+ private:
+  bool WriteFile() const;
+  void Serve();
+
+  const Stats* stats_;
+  std::string path_;
+  bool socket_;
+  std::chrono::milliseconds period_;
+  int fd_;
+  Doorbell signal_;
+  volatile bool shutdown_;
+};
+
+}  // namespace gvm
+
+#endif  // _GVM_STATS_H_
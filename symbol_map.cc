@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "symbol_map.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace gvm {
+
+SymbolMap::SymbolMap(const std::string& path) : path_(path) {}
+
+void SymbolMap::Load() const {
+  std::ifstream in(path_);
+  if (!in) {
+    std::cerr << "Unable to read symbol map " << path_ << "\n";
+    return;
+  }
+
+  std::string line;
+  for (int number = 1; std::getline(in, line); ++number) {
+    std::istringstream ss(line);
+    std::string kind;
+    if (!(ss >> kind) || kind[0] == '#') continue;
+
+    uint32_t start, end;
+    std::string name;
+    bool ok = true;
+    if (kind == "func" || kind == "line") {
+      ok = static_cast<bool>(ss >> std::hex >> start >> end >> name) &&
+           start <= end;
+      if (ok) (kind == "func" ? funcs_ : lines_)[start] = {end, name};
+    } else if (kind == "section") {
+      std::string type;
+      ok = static_cast<bool>(ss >> std::hex >> start >> end >> type) &&
+           start <= end;
+      // Empty sections would hide the one that starts at the same address.
+      if (ok && start != end) sections_[start] = {end, type};
+    } else if (kind == "label") {
+      ok = static_cast<bool>(ss >> std::hex >> start >> name);
+      if (ok) labels_[start] = name;
+    }
+    if (!ok) {
+      std::cerr << path_ << ":" << number << ": malformed " << kind
+                << " record. Ignoring the rest of the symbol map.\n";
+      return;
+    }
+  }
+}
+
+const SymbolMap::Range* SymbolMap::Find(
+    const std::map<uint32_t, Range>& ranges, uint32_t addr) {
+  auto it = ranges.upper_bound(addr);
+  if (it == ranges.begin()) return nullptr;
+  --it;
+  return addr < it->second.end ? &it->second : nullptr;
+}
+
+std::string SymbolMap::Name(uint32_t addr) const {
+  std::call_once(loaded_, [this]() { Load(); });
+  const Range* func = Find(funcs_, addr);
+  if (func != nullptr) return func->name;
+
+  auto label = labels_.upper_bound(addr);
+  if (label != labels_.begin()) {
+    --label;
+    // Without sections, any label before addr will do.
+    auto section = sections_.upper_bound(addr);
+    if (sections_.empty() ||
+        (section != sections_.begin() &&
+         label->first >= (--section)->first && addr < section->second.end)) {
+      return label->second;
+    }
+  }
+  std::stringstream ss;
+  ss << "0x" << std::hex << addr;
+  return ss.str();
+}
+
+std::string SymbolMap::Location(uint32_t addr) const {
+  std::call_once(loaded_, [this]() { Load(); });
+  const Range* line = Find(lines_, addr);
+  return line != nullptr ? line->name : "";
+}
+
+std::string SymbolMap::Describe(uint32_t addr) const {
+  const std::string location = Location(addr);
+  if (location.empty()) return Name(addr);
+  return Name(addr) + " (" + location + ")";
+}
+
+void SymbolMap::ForEachCodeLine(
+    const std::function<void(uint32_t start, uint32_t end,
+                             const std::string& location)>& fn) const {
+  std::call_once(loaded_, [this]() { Load(); });
+  for (const auto& line : lines_) {
+    if (line.first == line.second.end) continue;
+    const Range* section = Find(sections_, line.first);
+    if (section != nullptr && section->name != "text") continue;
+    fn(line.first, line.second.end, line.second.name);
+  }
+}
+
+}  // namespace gvm
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _GVM_SYMBOL_MAP_H_
+#define _GVM_SYMBOL_MAP_H_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace gvm {
+
+// SymbolMap names guest addresses using the symbol file written by gsm -s. It
+// has one record per line, addresses in hex and ranges as [start, end):
+//   section <start> <end> <text|data> <file>
+//   func <start> <end> <name>
+//   label <addr> <name>
+//   line <start> <end> <file>:<line>
+// Empty lines, lines starting with # and unknown records are ignored.
+//
+// The file is only read on the first lookup, so runs that never print an
+// address don't pay for it. Lookups can be made from any thread.
+class SymbolMap {
+ public:
+  explicit SymbolMap(const std::string& path);
+
+  // Name of the function containing addr or, outside functions, of the
+  // closest label before it in the same section. Unknown addresses are
+  // printed in hex.
+  std::string Name(uint32_t addr) const;
+
+  // "file:line" of the statement at addr, empty if unknown.
+  std::string Location(uint32_t addr) const;
+
+  // Name followed by the location, if known.
+  std::string Describe(uint32_t addr) const;
+
+  // Calls fn in address order with every line that has code in a text
+  // section.
+  void ForEachCodeLine(
+      const std::function<void(uint32_t start, uint32_t end,
+                               const std::string& location)>& fn) const;
+
+ private:
+  struct Range {
+    uint32_t end;
+    std::string name;
+  };
+
+  void Load() const;
+
+  // Returns the range containing addr or nullptr.
+  static const Range* Find(const std::map<uint32_t, Range>& ranges,
+                           uint32_t addr);
+
+  const std::string path_;
+  mutable std::once_flag loaded_;
+  // All keyed by start address.
+  mutable std::map<uint32_t, Range> sections_;
+  mutable std::map<uint32_t, Range> funcs_;
+  mutable std::map<uint32_t, std::string> labels_;
+  mutable std::map<uint32_t, Range> lines_;
+};
+
+}  // namespace gvm
+
+#endif  // _GVM_SYMBOL_MAP_H_
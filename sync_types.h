@@ -20,6 +20,9 @@
 #define _GVM_SYNC_TYPES_H_
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <functional>
 #include <mutex>
 #include <iostream>
@@ -97,6 +100,55 @@ class SyncPoint {
   SyncChan<bool> chan_;
 };
 
+// Doorbell is a one-way signal that never blocks the sender. Rings that happen
+// while the receiver is busy are coalesced and reported on the next Wait.
+class Doorbell {
+ public:
+  Doorbell() : rings_(0), closed_(false) {}
+
+  void Ring() {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      ++rings_;
+    }
+    event_.notify_one();
+  }
+
+  // Blocks until the doorbell rings. Returns the number of rings since the
+  // last call or 0 if the doorbell was closed.
+  uint32_t Wait() {
+    std::unique_lock<std::mutex> lk(mutex_);
+    event_.wait(lk, [this]{ return rings_ != 0 || closed_; });
+    const uint32_t rings = rings_;
+    rings_ = 0;
+    return rings;
+  }
+
+  // Same as Wait, but gives up at deadline and returns 0.
+  template <typename CLOCK, typename DURATION>
+  uint32_t WaitUntil(const std::chrono::time_point<CLOCK, DURATION>& deadline) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    event_.wait_until(lk, deadline, [this]{ return rings_ != 0 || closed_; });
+    const uint32_t rings = rings_;
+    rings_ = 0;
+    return rings;
+  }
+
+  void Close() {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      closed_ = true;
+    }
+    event_.notify_all();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable event_;
+  uint32_t rings_;
+  bool closed_;
+};
+
 
 }  // namespace
 
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "isa.h"
+
+namespace gvm {
+
+namespace {
+
+constexpr uint8_t kFp = kRegCount - 3;
+constexpr uint8_t kNone = TraceRecord::kNoRegister;
+
+// Register written by each opcode, kNone when the instruction only changes pc
+// or memory. Loads, stores with writeback and ALU ops write reg1, calls and
+// ret change fp.
+uint8_t DestRegister(uint32_t word) {
+  switch (word & 0x3F) {
+    case ISA::NOP:
+    case ISA::HALT:
+    case ISA::STOR_RI:
+    case ISA::STOR_IX:
+    case ISA::STOR_PC:
+    case ISA::JMP:
+    case ISA::JNE:
+    case ISA::JEQ:
+    case ISA::JGT:
+    case ISA::JGE:
+    case ISA::JLT:
+    case ISA::JLE:
+    case ISA::WFI:
+      return kNone;
+    case ISA::CALLI:
+    case ISA::CALLR:
+    case ISA::RET:
+      return kFp;
+    default:
+      if ((word & 0x3F) > ISA::WFI) return kNone;
+      return (word >> 6) & 0x1F;
+  }
+}
+
+}  // namespace
+
+constexpr uint8_t TraceRecord::kNoRegister;
+constexpr uint8_t TraceRecord::kLoad;
+constexpr uint8_t TraceRecord::kStore;
+constexpr uint32_t Tracer::kRingSize;
+constexpr char Tracer::kOutputOption[];
+constexpr uint8_t Tracer::kLoadAccess;
+constexpr uint8_t Tracer::kStoreAccess;
+
+Tracer::Tracer()
+    : ring_(kRingSize), active_(false), current_(nullptr), head_(0), tail_(0), written_(0),
+      out_(nullptr), shutdown_(false) {
+}
+
+Tracer::~Tracer() {
+  if (writer_.joinable()) Stop(nullptr);
+}
+
+void Tracer::Finish(const uint32_t* regs) {
+  const uint8_t reg = DestRegister(current_->word);
+  current_->reg = reg;
+  current_->reg_value = reg == kNone ? 0 : regs[reg];
+  current_->reserved = 0;
+  if (!(current_->flags & (TraceRecord::kLoad | TraceRecord::kStore))) {
+    current_->mem_addr = 0;
+    current_->mem_value = 0;
+  }
+  current_ = nullptr;
+  __atomic_store_n(&head_, head_ + 1, __ATOMIC_RELEASE);
+}
+
+bool Tracer::Start(const std::string& path, const SymbolMap* symbols) {
+  out_ = fopen(path.c_str(), "wb");
+  if (out_ == nullptr) {
+    std::cerr << "Unable to write trace to " << path << "\n";
+    return false;
+  }
+  path_ = path;
+  TraceHeader header = {};
+  std::copy(kTraceMagic, kTraceMagic + 4, header.magic);
+  header.version = kTraceVersion;
+  header.record_size = sizeof(TraceRecord);
+  fwrite(&header, sizeof(header), 1, out_);
+
+  shutdown_ = false;
+  writer_ = std::thread([this]() {
+    while (!shutdown_) {
+      signal_.WaitUntil(std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(1));
+      Write();
+    }
+    Write();
+  });
+  active_ = true;
+  return true;
+}
+
+void Tracer::Stop(const uint32_t* regs) {
+  if (!writer_.joinable()) return;
+  active_ = false;
+  if (current_ != nullptr) {
+    if (regs != nullptr) {
+      Finish(regs);
+    } else {
+      current_ = nullptr;
+    }
+  }
+  shutdown_ = true;
+  signal_.Close();
+  writer_.join();
+  fclose(out_);
+  out_ = nullptr;
+  std::cerr << "Trace records: " << written_ << " written to " << path_
+            << "\n";
+}
+
+void Tracer::Write() {
+  const uint32_t head = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+  while (tail_ != head) {
+    // Write the contiguous run up to head or the end of the ring.
+    const uint32_t start = tail_ % kRingSize;
+    const uint32_t count = std::min(head - tail_, kRingSize - start);
+    fwrite(&ring_[start], sizeof(TraceRecord), count, out_);
+    written_ += count;
+    __atomic_store_n(&tail_, tail_ + count, __ATOMIC_RELEASE);
+  }
+}
+
+}  // namespace gvm
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _GVM_TRACE_H_
+#define _GVM_TRACE_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "symbol_map.h"
+#include "sync_types.h"
+
+namespace gvm {
+
+// A trace file is a TraceHeader followed by one TraceRecord per instruction
+// run, in host byte order.
+struct TraceHeader {
+  char magic[4];  // "GVMT"
+  uint32_t version;
+  uint32_t record_size;
+  uint32_t reserved;
+};
+
+struct TraceRecord {
+  static constexpr uint8_t kNoRegister = 0xFF;
+  // Flags.
+  static constexpr uint8_t kLoad = 0x01;
+  static constexpr uint8_t kStore = 0x02;
+
+  uint32_t pc;
+  uint32_t word;
+  uint32_t reg_value;  // Value of reg after the instruction ran.
+  uint32_t mem_addr;   // First memory access, if kLoad or kStore is set.
+  uint32_t mem_value;
+  uint8_t reg;         // Register written by the instruction or kNoRegister.
+  uint8_t flags;
+  uint16_t reserved;
+};
+static_assert(sizeof(TraceRecord) == 24, "TraceRecord must stay 24 bytes");
+
+constexpr char kTraceMagic[4] = {'G', 'V', 'M', 'T'};
+constexpr uint32_t kTraceVersion = 1;
+
+// Tracer is a Core instrumentation policy that records every instruction.
+// The cpu thread fills records in place in a single producer ring and a
+// writer thread flushes them to the trace file. The cpu waits when the ring
+// is full, so no record is lost.
+class Tracer {
+ public:
+  static constexpr uint32_t kRingSize = 1 << 18;
+  static constexpr char kOutputOption[] = "trace_out";
+
+  Tracer();
+  ~Tracer();
+
+  // Nothing is recorded until Start succeeds, since without the writer
+  // thread the ring would fill and stall the cpu. Load and Store only fill
+  // the current record, so they are no-ops too.
+  void Op(uint32_t pc, uint32_t word, const uint32_t* regs) {
+    if (!active_) return;
+    if (current_ != nullptr) Finish(regs);
+    const uint32_t head = head_;
+    while (head - __atomic_load_n(&tail_, __ATOMIC_ACQUIRE) == kRingSize) {
+      std::this_thread::yield();
+    }
+    current_ = &ring_[head % kRingSize];
+    current_->pc = pc;
+    current_->word = word;
+    current_->flags = 0;
+  }
+  void Branch(uint32_t opcode, bool taken) {}
+  void Load(uint32_t addr, uint32_t value) { Access(kLoadAccess, addr, value); }
+  void Store(uint32_t addr, uint32_t value) {
+    Access(kStoreAccess, addr, value);
+  }
+  void Call(uint32_t site) {}
+  void Ret() {}
+  void Block(uint32_t pc) {}
+
+  // Opens the trace file and starts the writer thread. gvm-trace names
+  // addresses, so symbols aren't used.
+  bool Start(const std::string& path, const SymbolMap* symbols);
+  // Flushes every record and closes the file. regs are the registers after
+  // the last instruction ran.
+  void Stop(const uint32_t* regs);
+
+ private:
+  static constexpr uint8_t kLoadAccess = TraceRecord::kLoad;
+  static constexpr uint8_t kStoreAccess = TraceRecord::kStore;
+
+  void Access(uint8_t kind, uint32_t addr, uint32_t value) {
+    if (current_ == nullptr ||
+        (current_->flags & (TraceRecord::kLoad | TraceRecord::kStore))) {
+      return;
+    }
+    current_->flags |= kind;
+    current_->mem_addr = addr;
+    current_->mem_value = value;
+  }
+
+  // Completes the current record with the register its instruction wrote.
+  void Finish(const uint32_t* regs);
+
+  void Write();
+
+  std::vector<TraceRecord> ring_;
+  bool active_;
+  TraceRecord* current_;
+  uint32_t head_;
+  uint32_t tail_;
+  uint64_t written_;
+  std::string path_;
+  FILE* out_;
+  std::thread writer_;
+  Doorbell signal_;
+  volatile bool shutdown_;
+};
+
+}  // namespace gvm
+
+#endif  // _GVM_TRACE_H_
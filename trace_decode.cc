@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2019  Igor Cananea <icc@avalonbits.com>
+ * Author: Igor Cananea <icc@avalonbits.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// gvm-trace prints the execution trace written by a dstep=1 build of gvm
+// with --trace_out, one disassembled instruction per line.
+
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+
+#include "cxxopts.hpp"
+#include "isa.h"
+#include "symbol_map.h"
+#include "trace.h"
+
+int main(int argc, char* argv[]) {
+  cxxopts::Options options("gvm-trace", "Prints a GVM execution trace.");
+  options.add_options()
+    ("trace", "Trace file written by gvm --trace_out.",
+              cxxopts::value<std::string>()->default_value(""))
+    ("symbols", "Symbol map written by gsm -s, used to name addresses.",
+                cxxopts::value<std::string>()->default_value(""))
+    ("limit", "Stop after this many records. 0 prints all of them.",
+              cxxopts::value<uint64_t>()->default_value("0"));
+  options.parse_positional({"trace"});
+  const auto result = options.parse(argc, argv);
+
+  const std::string path = result["trace"].as<std::string>();
+  std::ifstream in(path, std::ifstream::binary | std::ifstream::in);
+  if (!in) {
+    std::cerr << "Unable to read trace " << path << "\n";
+    return 1;
+  }
+  gvm::TraceHeader header;
+  in.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!in || std::memcmp(header.magic, gvm::kTraceMagic, 4) != 0 ||
+      header.version != gvm::kTraceVersion ||
+      header.record_size != sizeof(gvm::TraceRecord)) {
+    std::cerr << path << " is not a version " << gvm::kTraceVersion
+              << " GVM trace\n";
+    return 1;
+  }
+
+  std::unique_ptr<gvm::SymbolMap> symbols;
+  const std::string symbols_path = result["symbols"].as<std::string>();
+  if (!symbols_path.empty()) {
+    symbols.reset(new gvm::SymbolMap(symbols_path));
+  }
+
+  const uint64_t limit = result["limit"].as<uint64_t>();
+  gvm::TraceRecord record;
+  std::cout << std::hex << std::setfill('0');
+  for (uint64_t count = 0; limit == 0 || count < limit; ++count) {
+    in.read(reinterpret_cast<char*>(&record), sizeof(record));
+    if (!in) break;
+    std::cout << "0x" << std::setw(8) << record.pc << ": ";
+    if (symbols != nullptr) {
+      std::cout << "[" << symbols->Describe(record.pc) << "] ";
+    }
+    std::cout << gvm::PrintInstruction(record.pc, record.word);
+    if (record.reg != gvm::TraceRecord::kNoRegister) {
+      std::cout << " ; r" << std::dec << static_cast<uint32_t>(record.reg)
+                << std::hex << " = 0x" << record.reg_value;
+    }
+    if (record.flags & (gvm::TraceRecord::kLoad | gvm::TraceRecord::kStore)) {
+      std::cout << " ; [0x" << record.mem_addr << "] "
+                << ((record.flags & gvm::TraceRecord::kLoad) ? "->" : "<-")
+                << " 0x" << record.mem_value;
+    }
+    std::cout << "\n";
+  }
+  return 0;
+}
@@ -21,53 +21,124 @@
 #include <cassert>
 #include <chrono>
 #include <iostream>
-#include <SDL2/SDL.h>
+#include <thread>
 
 #include "isa.h"
 
 namespace gvm {
 
 VideoController::VideoController(const bool print_fps, VideoDisplay* display)
-  : print_fps_(false), display_(display), shutdown_(false) {
+  : print_fps_(print_fps), vblank_period_(0), frame_period_(0),
+    pending_(0), fps_frames_(0), requested_(0), presented_(0),
+    coalesced_(0), dropped_(0), page_reg_(0),
+    first_row_reg_(0), cursor_reg_(0), page_count_(0), page_(0),
+    display_(display), shutdown_(false) {
   assert(display != nullptr);
 }
 
-static int ReadInput(void* ptr) {
-  InputController* input = reinterpret_cast<InputController*>(ptr);
-  input->Read();
-  return 0;
-}
-
 void VideoController::Run() {
-  auto start = std::chrono::high_resolution_clock::now();
   display_->Render(1);
-  SDL_Thread* input_thread = SDL_CreateThread(
-      ReadInput, "ReadInput", reinterpret_cast<void*>(input_controller_.get()));
+  auto* input = input_controller_.get();
+  std::thread input_thread([input]() {
+    input->Read();
+  });
 
+  const auto start = std::chrono::steady_clock::now();
+  auto next_vblank = start + vblank_period_;
+  next_frame_ = start;
+  fps_start_ = start;
   while (!shutdown_) {
-    signal_->recv();
-    if (mem_[mem_reg_] == 0) {
-      continue;
+    // Sleep until the guest rings, the next vblank or the next frame slot if
+    // a frame is waiting for it.
+    const bool vblank = vblank_period_.count() != 0;
+    const bool paced = pending_ != 0 && frame_period_.count() != 0;
+    auto deadline = next_vblank;
+    if (paced && (!vblank || next_frame_ < deadline)) deadline = next_frame_;
+    const uint64_t rings =
+        vblank || paced ? signal_->WaitUntil(deadline) : signal_->Wait();
+    requested_ += rings;
+    pending_ += rings;
+
+    const auto now = std::chrono::steady_clock::now();
+    if (pending_ != 0 && (frame_period_.count() == 0 || now >= next_frame_)) {
+      // Without a vblank frequency, each frame is followed by a vblank.
+      if (PresentPending(now) && !vblank && interrupt_) {
+        interrupt_(kVideoVblank);
+      }
+    }
+    if (vblank && now >= next_vblank) {
+      if (interrupt_) interrupt_(kVideoVblank);
+      next_vblank += vblank_period_;
+      if (next_vblank < now) next_vblank = now + vblank_period_;
     }
+  }
+  input_controller_->Shutdown();
+  input_thread.join();
+}
+
+bool VideoController::PresentPending(
+    std::chrono::steady_clock::time_point now) {
+  if (mem_[mem_reg_] == 0) {
+    // The guest rang without a frame to show.
+    pending_ = 0;
+    return false;
+  }
+  coalesced_ += pending_ - 1;
+  pending_ = 0;
+  Present();
+  ++presented_;
+  if (frame_period_.count() == 0) return true;
+
+  // Slots are kept on a fixed grid. After an idle period the grid restarts
+  // from now, and slots that passed while presenting are dropped.
+  if (next_frame_ + frame_period_ < now) next_frame_ = now;
+  next_frame_ += frame_period_;
+  const auto end = std::chrono::steady_clock::now();
+  if (end > next_frame_) {
+    const uint64_t missed = (end - next_frame_) / frame_period_ + 1;
+    dropped_ += missed;
+    next_frame_ += missed * frame_period_;
+  }
+  return true;
+}
 
-    const uint32_t mode = mem_[mem_reg_];
-    display_->CopyBuffer(&mem_[mem_addr_], mode);
-    mem_[mem_reg_] = 0;
+void VideoController::Present() {
+  const auto start = std::chrono::steady_clock::now();
+
+  // The display page is latched here, so the guest can draw the next frame
+  // on another page while this one is copied. The register is cleared as it
+  // is latched, so a mode written and rung during the copy is kept for the
+  // next frame.
+  uint32_t mode = __atomic_exchange_n(&mem_[mem_reg_], 0, __ATOMIC_SEQ_CST);
+  const uint32_t page = FramePage(mode);
+  uint32_t* frame = &mem_[mem_addr_ + page * (kPageSize / kWordSize)];
+  if (mode == kTextMode && first_row_reg_ != 0) {
+    display_->SetTextState(mem_[first_row_reg_], mem_[cursor_reg_]);
+  }
+  if (compositor_ != nullptr && compositor_->Enabled() &&
+      (mode == kGraphicsMode || mode == kIndexedGraphicsMode)) {
+    frame = const_cast<uint32_t*>(compositor_->Compose(frame, mode));
+    mode = kGraphicsMode;
+  }
+  display_->CopyBuffer(frame, mode);
+  if (page != page_) {
+    page_ = page;
+    if (interrupt_) interrupt_(kVideoFlipDone);
+  }
 
-    if (print_fps_) start = std::chrono::high_resolution_clock::now();
-    display_->Render(mode);
+  display_->Render(mode);
+  const auto end = std::chrono::steady_clock::now();
+  frame_time_.Add(std::chrono::nanoseconds(end - start).count());
 
-    if (print_fps_) {
-      const std::chrono::nanoseconds runtime =
-          std::chrono::high_resolution_clock::now() - start;
-      const auto time = runtime.count();
-      std::cout << "Avergate fps: " << (1 / (time / static_cast<double>(1000000000)))
-                << "\n";
+  if (print_fps_) {
+    ++fps_frames_;
+    const std::chrono::duration<double> elapsed = end - fps_start_;
+    if (elapsed.count() >= 1.0) {
+      std::cerr << "FPS: " << (fps_frames_ / elapsed.count()) << "\n";
+      fps_frames_ = 0;
+      fps_start_ = end;
     }
   }
-  input_controller_->Shutdown();
-  int v;
-  SDL_WaitThread(input_thread, &v);
 }
 
 void VideoController::RegisterDMA(
@@ -77,14 +148,63 @@ void VideoController::RegisterDMA(
   mem_reg_ = mem_reg / sizeof(uint32_t);
   mem_addr_ = mem_addr;
   mem_ = mem;
+  fWidth_ = fWidth;
+  fHeight_ = fHeight;
   display_->SetFramebufferSize(fWidth, fHeight, bpp);
 }
 
+void VideoController::SetVblankFrequency(uint32_t hz) {
+  vblank_period_ = hz == 0
+      ? std::chrono::nanoseconds(0)
+      : std::chrono::nanoseconds(1000000000 / hz);
+}
+
+void VideoController::SetTargetFps(uint32_t fps) {
+  frame_period_ = fps == 0
+      ? std::chrono::nanoseconds(0)
+      : std::chrono::nanoseconds(1000000000 / fps);
+}
+
+void VideoController::PrintStats(std::ostream& out) const {
+  out << "Frames requested: " << requested_ << "\n";
+  out << "Frames presented: " << presented_ << "\n";
+  out << "Frames coalesced: " << coalesced_ << "\n";
+  out << "Frames dropped: " << dropped_ << "\n";
+  if (frame_time_.count() == 0) return;
+  out << "Frame time: p50 " << (frame_time_.Percentile(50) / 1000000.0)
+      << "ms, p90 " << (frame_time_.Percentile(90) / 1000000.0)
+      << "ms, p99 " << (frame_time_.Percentile(99) / 1000000.0)
+      << "ms, max " << (frame_time_.max() / 1000000.0) << "ms\n";
+}
+
+void VideoController::SetTextRegisters(uint32_t first_row_reg,
+                                       uint32_t cursor_reg) {
+  first_row_reg_ = first_row_reg / sizeof(uint32_t);
+  cursor_reg_ = cursor_reg / sizeof(uint32_t);
+}
+
+void VideoController::SetDisplayPage(uint32_t page_reg, uint32_t vram_size) {
+  page_reg_ = page_reg / sizeof(uint32_t);
+  page_count_ = vram_size / kPageSize;
+}
+
+uint32_t VideoController::FramePage(uint32_t mode) const {
+  if (page_count_ == 0) return 0;
+
+  uint32_t frame_size = 100 * 28 * sizeof(uint32_t);
+  if (mode == kGraphicsMode) {
+    frame_size = fWidth_ * fHeight_ * sizeof(uint32_t);
+  } else if (mode == kIndexedGraphicsMode) {
+    frame_size = fWidth_ * fHeight_;
+  }
+  if (frame_size > kPageSize) return 0;
+
+  const uint32_t page = mem_[page_reg_];
+  return page < page_count_ ? page : page_;
+}
+
 void VideoController::Shutdown() {
   shutdown_ = true;
-  SDL_Event ev;
-  ev.type = SDL_QUIT;
-  SDL_PushEvent(&ev);
   signal_->Close();
 }
 
@@ -19,14 +19,24 @@
 #ifndef _GVM_VIDEO_CONTROLLER_H_
 #define _GVM_VIDEO_CONTROLLER_H_
 
+#include <chrono>
 #include <cstdint>
+#include <functional>
+#include <ostream>
 
+#include "compositor.h"
+#include "histogram.h"
 #include "input_controller.h"
 #include "sync_types.h"
 #include "video_display.h"
 
 namespace gvm {
 
+// Bits set in the video status register when the video interrupt is raised.
+constexpr uint32_t kVideoFlipDone = 0x01;
+constexpr uint32_t kVideoVblank = 0x02;
+constexpr uint32_t kVideoBlitDone = 0x04;
+
 class VideoController {
  public:
   // Takes ownership of display.
@@ -34,23 +44,94 @@ class VideoController {
 
   void RegisterDMA(uint32_t mem_reg, uint32_t mem_addr, int fWidth,
                    int fHeight, int bpp, uint32_t* mem);
+
+  // Frame pages start every kPageSize bytes in vram. The page shown is read
+  // from page_reg when a frame is presented. Modes whose frame does not fit
+  // in a page can only use page 0.
+  static constexpr uint32_t kPageSize = 256 * 1024;
+  void SetDisplayPage(uint32_t page_reg, uint32_t vram_size);
+
+  // Registers handed to the display along with each text mode frame. See
+  // VideoDisplay::SetTextState.
+  void SetTextRegisters(uint32_t first_row_reg, uint32_t cursor_reg);
+
+  // Takes ownership of compositor. When its layers are enabled, graphics
+  // frames are composed by it before being handed to the display.
+  void SetCompositor(Compositor* compositor) { compositor_.reset(compositor); }
+
   void SetInputController(InputController* input_controller) {
     input_controller_.reset(input_controller);
   }
-  void SetSignal(SyncPoint* signal) { signal_ = signal; }
+  void SetSignal(Doorbell* signal) { signal_ = signal; }
+  void SetInterrupt(std::function<void(uint32_t status)> interrupt) {
+    interrupt_ = interrupt;
+  }
+
+  // By default, hz == 0, a vblank interrupt is raised after each frame is
+  // presented, with any display. With hz > 0 it is raised hz times per
+  // second instead, whether or not the guest rang the doorbell. main only
+  // sets it for the headless displays, which have no refresh to sync to.
+  void SetVblankFrequency(uint32_t hz);
+
+  // Frames are presented at most fps times per second. Doorbells that arrive
+  // before the next frame is due are coalesced into it. 0 presents a frame
+  // for every doorbell, as fast as the display allows.
+  void SetTargetFps(uint32_t fps);
+
+  // Prints frame counters and frame time percentiles. Call after Run returns.
+  void PrintStats(std::ostream& out) const;
+  // Frame counters, safe to read while running.
+  uint64_t requested() const { return Load(requested_); }
+  uint64_t presented() const { return Load(presented_); }
+  uint64_t coalesced() const { return Load(coalesced_); }
+  uint64_t dropped() const { return Load(dropped_); }
+  // Read while running, percentiles may be slightly off.
+  const Histogram& frame_time() const { return frame_time_; }
   void SetTextRom(uint32_t* mem) { display_->SetTextRom(mem); }
   void SetColorTable(uint32_t* mem) { display_->SetColorTable(mem); }
   void Run();
   void Shutdown();
 
  private:
+  static uint64_t Load(const uint64_t& v) {
+    return __atomic_load_n(&v, __ATOMIC_RELAXED);
+  }
+  uint32_t FramePage(uint32_t mode) const;
+  void Present();
+  // Returns whether a frame was presented.
+  bool PresentPending(std::chrono::steady_clock::time_point now);
+
   const bool print_fps_;
-  SyncPoint* signal_;
+  Doorbell* signal_;
+  std::function<void(uint32_t status)> interrupt_;
+  std::chrono::nanoseconds vblank_period_;
+  std::chrono::nanoseconds frame_period_;
+  std::chrono::steady_clock::time_point next_frame_;
+  std::chrono::steady_clock::time_point fps_start_;
+  uint64_t pending_;
+  uint64_t fps_frames_;
+
+  // Frame counters. requested counts doorbells, coalesced the ones merged
+  // into a later frame and dropped the frame slots missed because presenting
+  // ran late.
+  uint64_t requested_;
+  uint64_t presented_;
+  uint64_t coalesced_;
+  uint64_t dropped_;
+  Histogram frame_time_;  // ns spent presenting each frame.
   uint32_t mem_reg_;
   uint32_t mem_addr_;
+  uint32_t page_reg_;
+  uint32_t first_row_reg_;
+  uint32_t cursor_reg_;
+  uint32_t page_count_;
+  uint32_t page_;
+  int fWidth_;
+  int fHeight_;
   uint32_t* mem_;
   std::unique_ptr<VideoDisplay> display_;
   std::unique_ptr<InputController> input_controller_;
+  std::unique_ptr<Compositor> compositor_;
   volatile bool shutdown_;
 
 };
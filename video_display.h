@@ -20,10 +20,16 @@
 #define _GVM_VIDEO_DISPLAY_H_
 
 #include <atomic>
+#include <cstdint>
 #include <memory>
 
 namespace gvm {
 
+// Video modes selected by the value the guest writes to the vram register.
+constexpr uint32_t kGraphicsMode = 1;         // 32bpp ABGR8888 framebuffer.
+constexpr uint32_t kTextMode = 2;             // 100x28 character cells.
+constexpr uint32_t kIndexedGraphicsMode = 3;  // 8bpp, indexed through the color table.
+
 class VideoDisplay {
  public:
   explicit VideoDisplay() {}
@@ -33,8 +39,16 @@ class VideoDisplay {
   virtual void SetTextRom(uint32_t* mem) = 0;
   virtual void SetColorTable(uint32_t* mem) = 0;
   virtual void CopyBuffer(uint32_t* mem, uint32_t mode) = 0;
+
+  // Text mode rows form a ring buffer and first_row is the row shown at the
+  // top of the screen. cursor holds the cursor column in bits 0-7, its screen
+  // row in bits 8-15 and bit 16 enables it.
+  virtual void SetTextState(uint32_t first_row, uint32_t cursor) = 0;
   virtual void Render(uint32_t mode) = 0;
   virtual bool CheckEvents() = 0;
+
+  // Displays without a window don't pace vblank by presented frames.
+  virtual bool HasWindow() const { return false; }
 };
 
 }  // namespace gvm